@@ -0,0 +1,45 @@
+#ifndef LED_BACKEND_H
+#define LED_BACKEND_H
+
+// Output backends behind the application's effect functions. LEDs are
+// addressed as bits of a mask so a backend can update several at once.
+
+#define DEVICE_PATH "/dev/led_controller"
+#define GPIO_CHIP_PATH "/dev/gpiochip0"
+#define DEFAULT_GPIO_LINES "17,18,27"
+
+typedef struct LedBackend LedBackend;
+
+struct LedBackend {
+  const char *name;
+  unsigned int num_leds;
+  // Drive the LEDs selected by mask to the matching bits of values
+  int (*set_values)(LedBackend *b, unsigned long long mask,
+                    unsigned long long values);
+  // Level of the first LED: 0, 1, or -1 on error
+  int (*get_value)(LedBackend *b);
+  void (*close)(LedBackend *b);
+};
+
+// The driver's char device, e.g. /dev/led_controller
+LedBackend *led_backend_open_chardev(const char *path);
+
+// GPIO character device v2 uAPI: chip e.g. /dev/gpiochip0, lines e.g.
+// "17,18,27", all requested as outputs in a single line request
+LedBackend *led_backend_open_gpio(const char *chip, const char *lines);
+
+// Select by name ("chardev" or "gpio"); target is the device path
+LedBackend *led_backend_open(const char *name, const char *target,
+                             const char *lines);
+
+static inline unsigned long long led_backend_all(LedBackend *b) {
+  return b->num_leds >= 64 ? ~0ULL : (1ULL << b->num_leds) - 1;
+}
+
+// Turn every LED on or off with one batched update
+static inline int led_backend_set(LedBackend *b, int on) {
+  unsigned long long all = led_backend_all(b);
+  return b->set_values(b, all, on ? all : 0);
+}
+
+#endif // LED_BACKEND_H
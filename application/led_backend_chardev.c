@@ -0,0 +1,72 @@
+#include "led_backend.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  LedBackend base;
+  int fd;
+} ChardevBackend;
+
+// The char device drives one LED per node; any selected bit switches it
+static int chardev_set_values(LedBackend *b, unsigned long long mask,
+                              unsigned long long values) {
+  ChardevBackend *cb = (ChardevBackend *)b;
+  char cmd = (values & mask) ? '1' : '0';
+
+  if (!mask)
+    return 0;
+
+  return write(cb->fd, &cmd, 1) == 1 ? 0 : -1;
+}
+
+static int chardev_get_value(LedBackend *b) {
+  ChardevBackend *cb = (ChardevBackend *)b;
+  char status;
+
+  if (pread(cb->fd, &status, 1, 0) != 1)
+    return -1;
+
+  return status == '1';
+}
+
+static void chardev_close(LedBackend *b) {
+  ChardevBackend *cb = (ChardevBackend *)b;
+
+  close(cb->fd);
+  free(cb);
+}
+
+LedBackend *led_backend_open_chardev(const char *path) {
+  ChardevBackend *cb = calloc(1, sizeof(*cb));
+
+  if (!cb)
+    return NULL;
+
+  cb->fd = open(path, O_RDWR);
+  if (cb->fd < 0) {
+    perror("Failed to open the device");
+    free(cb);
+    return NULL;
+  }
+
+  cb->base.name = "chardev";
+  cb->base.num_leds = 1;
+  cb->base.set_values = chardev_set_values;
+  cb->base.get_value = chardev_get_value;
+  cb->base.close = chardev_close;
+  return &cb->base;
+}
+
+LedBackend *led_backend_open(const char *name, const char *target,
+                             const char *lines) {
+  if (!strcmp(name, "chardev"))
+    return led_backend_open_chardev(target);
+  if (!strcmp(name, "gpio"))
+    return led_backend_open_gpio(target, lines);
+
+  fprintf(stderr, "Unknown backend: %s\n", name);
+  return NULL;
+}
@@ -0,0 +1,109 @@
+#include "led_backend.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define CONSUMER "led_controller"
+
+typedef struct {
+  LedBackend base;
+  int line_fd;
+} GpioBackend;
+
+// One ioctl updates every selected line of the request at once
+static int gpio_set_values(LedBackend *b, unsigned long long mask,
+                           unsigned long long values) {
+  GpioBackend *gb = (GpioBackend *)b;
+  struct gpio_v2_line_values lv = {.bits = values, .mask = mask};
+
+  return ioctl(gb->line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv);
+}
+
+static int gpio_get_value(LedBackend *b) {
+  GpioBackend *gb = (GpioBackend *)b;
+  struct gpio_v2_line_values lv = {.mask = 1};
+
+  if (ioctl(gb->line_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv))
+    return -1;
+
+  return lv.bits & 1;
+}
+
+static void gpio_close(LedBackend *b) {
+  GpioBackend *gb = (GpioBackend *)b;
+
+  close(gb->line_fd);
+  free(gb);
+}
+
+LedBackend *led_backend_open_gpio(const char *chip, const char *lines) {
+  struct gpio_v2_line_request req;
+  char spec[256], *tok, *save, *end;
+  unsigned long offset;
+  GpioBackend *gb;
+  int chip_fd;
+
+  memset(&req, 0, sizeof(req));
+  if (snprintf(spec, sizeof(spec), "%s", lines ? lines : "") >=
+      (int)sizeof(spec)) {
+    fprintf(stderr, "GPIO line list too long (max %zu characters)\n",
+            sizeof(spec) - 1);
+    return NULL;
+  }
+  for (tok = strtok_r(spec, ",", &save); tok;
+       tok = strtok_r(NULL, ",", &save)) {
+    if (req.num_lines == GPIO_V2_LINES_MAX) {
+      fprintf(stderr, "Too many GPIO lines (max %d)\n", GPIO_V2_LINES_MAX);
+      return NULL;
+    }
+    errno = 0;
+    offset = strtoul(tok, &end, 10);
+    if (!isdigit((unsigned char)*tok) || *end || errno ||
+        offset > UINT32_MAX) {
+      fprintf(stderr, "Invalid GPIO line offset: \"%s\"\n", tok);
+      return NULL;
+    }
+    req.offsets[req.num_lines++] = offset;
+  }
+  if (!req.num_lines) {
+    fprintf(stderr, "No GPIO lines given\n");
+    return NULL;
+  }
+
+  snprintf(req.consumer, sizeof(req.consumer), "%s", CONSUMER);
+  req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+
+  chip_fd = open(chip, O_RDWR | O_CLOEXEC);
+  if (chip_fd < 0) {
+    perror("Failed to open the GPIO chip");
+    return NULL;
+  }
+
+  if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req)) {
+    perror("Failed to request GPIO lines");
+    close(chip_fd);
+    return NULL;
+  }
+  close(chip_fd);
+
+  gb = calloc(1, sizeof(*gb));
+  if (!gb) {
+    close(req.fd);
+    return NULL;
+  }
+
+  gb->line_fd = req.fd;
+  gb->base.name = "gpio";
+  gb->base.num_leds = req.num_lines;
+  gb->base.set_values = gpio_set_values;
+  gb->base.get_value = gpio_get_value;
+  gb->base.close = gpio_close;
+  return &gb->base;
+}
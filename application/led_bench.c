@@ -0,0 +1,110 @@
+#include "led_backend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Toggle throughput and latency of each output backend. On hosts without
+// the LEDs point it at a gpio-sim chip:
+//
+//   led_bench -c /dev/gpiochip1 -l 0,1,2,3 -n 200000
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int compare_ull(const void *a, const void *b) {
+  unsigned long long x = *(const unsigned long long *)a;
+  unsigned long long y = *(const unsigned long long *)b;
+  return (x > y) - (x < y);
+}
+
+// Toggle all LEDs n times. With per_line set, each toggle updates the
+// lines one call at a time instead of in a single batched call.
+static void bench_backend(LedBackend *led, int n, int per_line) {
+  unsigned long long *lat = malloc(n * sizeof(*lat));
+  unsigned long long all = led_backend_all(led);
+  unsigned long long start, total = 0;
+  int errors = 0;
+
+  if (!lat)
+    return;
+
+  for (int i = 0; i < n; i++) {
+    unsigned long long values = (i & 1) ? 0 : all;
+
+    start = now_ns();
+    if (per_line) {
+      for (unsigned int l = 0; l < led->num_leds; l++)
+        errors += led->set_values(led, 1ULL << l, values) != 0;
+    } else {
+      errors += led->set_values(led, all, values) != 0;
+    }
+    lat[i] = now_ns() - start;
+    total += lat[i];
+  }
+
+  qsort(lat, n, sizeof(*lat), compare_ull);
+  printf("%-8s %-8s %2u LEDs  %10.0f toggles/s  avg %7.2f us  "
+         "p50 %7.2f us  p99 %7.2f us  max %8.2f us  errors %d\n",
+         led->name, per_line ? "per-line" : "batched", led->num_leds,
+         n / (total / 1e9), total / 1000.0 / n, lat[n / 2] / 1000.0,
+         lat[(int)(n * 0.99)] / 1000.0, lat[n - 1] / 1000.0, errors);
+
+  led_backend_set(led, 0);
+  free(lat);
+}
+
+int main(int argc, char *argv[]) {
+  const char *device = DEVICE_PATH;
+  const char *chip = GPIO_CHIP_PATH;
+  const char *lines = DEFAULT_GPIO_LINES;
+  LedBackend *led;
+  int n = 100000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:c:l:n:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      device = optarg;
+      break;
+    case 'c':
+      chip = optarg;
+      break;
+    case 'l':
+      lines = optarg;
+      break;
+    case 'n':
+      n = atoi(optarg);
+      break;
+    default:
+      printf("Usage: %s [-d device] [-c gpiochip] [-l lines] [-n toggles]\n",
+             argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (n < 1) {
+    fprintf(stderr, "Toggle count must be positive\n");
+    return 1;
+  }
+
+  led = led_backend_open_chardev(device);
+  if (led) {
+    bench_backend(led, n, 0);
+    led->close(led);
+  }
+
+  led = led_backend_open_gpio(chip, lines);
+  if (led) {
+    bench_backend(led, n, 0);
+    if (led->num_leds > 1)
+      bench_backend(led, n, 1);
+    led->close(led);
+  }
+
+  return 0;
+}
@@ -0,0 +1,346 @@
+#include "gpio_ioctl.h"
+#include "led_backend.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOCK_STAT_PATH "/proc/lock_stat"
+
+// Concurrency stress for the driver's write/read/ioctl paths. Run it with
+// the blink timer live so timer callbacks race the user-space callers.
+// With -t the LED also toggles on edges of a trigger GPIO that a helper
+// thread flips through a gpio-sim pull file, so the interrupt handler
+// joins the race:
+//
+//   led_stress [-t gpio -p sim_pull_file] [max_threads] [seconds] [device]
+
+enum stress_op {
+  OP_WRITE_ON,
+  OP_WRITE_OFF,
+  OP_READ,
+  OP_BLINK,
+  OP_BRIGHTNESS,
+  OP_STATS,
+  OP_RESET,
+  OP_COUNT,
+};
+
+static const char *op_names[OP_COUNT] = {
+    "write 1", "write 0", "read",  "blink",
+    "bright",  "stats",   "reset",
+};
+
+typedef struct {
+  unsigned long count;
+  unsigned long errors;
+  unsigned long long total_ns;
+  unsigned long long max_ns;
+} OpStats;
+
+typedef struct {
+  pthread_t thread;
+  const char *device;
+  unsigned int seed;
+  OpStats ops[OP_COUNT];
+  unsigned long inconsistencies;
+} Worker;
+
+typedef struct {
+  pthread_t thread;
+  const char *device;
+  const char *pull_path;
+  int gpio;
+  unsigned long edges;
+  int failed;
+} TriggerSource;
+
+static atomic_bool stop;
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Run one operation; returns 0 on success, -1 on syscall failure and 1
+// when the driver reported something that cannot be true
+static int run_op(int fd, enum stress_op op, Worker *w,
+                  struct led_stats *last) {
+  struct led_blink_params blink = {.delay_on = 1, .delay_off = 1};
+  struct led_stats stats;
+  int brightness;
+  char c;
+
+  switch (op) {
+  case OP_WRITE_ON:
+    c = '1';
+    return write(fd, &c, 1) == 1 ? 0 : -1;
+  case OP_WRITE_OFF:
+    c = '0';
+    return write(fd, &c, 1) == 1 ? 0 : -1;
+  case OP_READ:
+    if (pread(fd, &c, 1, 0) != 1)
+      return -1;
+    return c == '0' || c == '1' ? 0 : 1;
+  case OP_BLINK:
+    return ioctl(fd, LED_SET_BLINK, &blink) ? -1 : 0;
+  case OP_BRIGHTNESS:
+    brightness = rand_r(&w->seed) % 101;
+    return ioctl(fd, LED_SET_BRIGHTNESS, &brightness) ? -1 : 0;
+  case OP_STATS:
+    if (ioctl(fd, LED_GET_STATS, &stats))
+      return -1;
+    // Counters only grow and weighted time never exceeds lit time
+    if (stats.switches < last->switches ||
+        stats.on_time_ns < last->on_time_ns ||
+        stats.duty_time_ns > stats.on_time_ns) {
+      *last = stats;
+      return 1;
+    }
+    *last = stats;
+    return 0;
+  case OP_RESET:
+    return ioctl(fd, LED_RESET) ? -1 : 0;
+  default:
+    return -1;
+  }
+}
+
+static void *worker_main(void *arg) {
+  Worker *w = arg;
+  struct led_stats last = {0};
+  int fd = open(w->device, O_RDWR);
+
+  if (fd < 0) {
+    perror("Failed to open the device");
+    return NULL;
+  }
+
+  while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+    enum stress_op op = rand_r(&w->seed) % OP_COUNT;
+    unsigned long long start = now_ns();
+    int ret = run_op(fd, op, w, &last);
+    unsigned long long elapsed = now_ns() - start;
+    OpStats *s = &w->ops[op];
+
+    s->count++;
+    s->total_ns += elapsed;
+    if (elapsed > s->max_ns)
+      s->max_ns = elapsed;
+    if (ret < 0)
+      s->errors++;
+    else if (ret > 0)
+      w->inconsistencies++;
+  }
+
+  close(fd);
+  return NULL;
+}
+
+// Install the trigger, then flip the simulated input until the round ends
+static void *trigger_main(void *arg) {
+  TriggerSource *t = arg;
+  struct trigger_params params = {
+      .gpio_trigger = t->gpio, .rising_edge = true, .falling_edge = true};
+  int fd = open(t->device, O_RDWR);
+  int pull = open(t->pull_path, O_WRONLY);
+
+  if (fd < 0 || pull < 0 || ioctl(fd, LED_SET_TRIGGER, &params)) {
+    perror("Failed to set up the trigger");
+    t->failed = 1;
+    goto out;
+  }
+
+  while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+    const char *level = t->edges & 1 ? "pull-down" : "pull-up";
+
+    if (pwrite(pull, level, strlen(level), 0) < 0) {
+      perror("Failed to flip the trigger input");
+      t->failed = 1;
+      break;
+    }
+    t->edges++;
+  }
+
+  params.gpio_trigger = -1;
+  ioctl(fd, LED_SET_TRIGGER, &params);
+out:
+  if (pull >= 0)
+    close(pull);
+  if (fd >= 0)
+    close(fd);
+  return NULL;
+}
+
+// After LED_RESET nothing may toggle the LED again; a blink timer that
+// survived the reset shows up as a read of '1' or a moving switch count
+static int check_quiescent(const char *device) {
+  struct led_stats before, after;
+  int fd = open(device, O_RDWR);
+  int bad = 0;
+  char c;
+
+  if (fd < 0)
+    return 1;
+
+  ioctl(fd, LED_RESET);
+  usleep(20000);
+  ioctl(fd, LED_GET_STATS, &before);
+  for (int i = 0; i < 5; i++) {
+    usleep(10000);
+    if (pread(fd, &c, 1, 0) != 1 || c != '0')
+      bad = 1;
+  }
+  ioctl(fd, LED_GET_STATS, &after);
+  if (after.switches != before.switches)
+    bad = 1;
+
+  close(fd);
+  return bad;
+}
+
+// Print the driver's lock classes from /proc/lock_stat (CONFIG_LOCK_STAT)
+static void print_lock_stat(void) {
+  char line[512];
+  FILE *f = fopen(LOCK_STAT_PATH, "r");
+
+  if (!f) {
+    printf("  lock hold/wait: %s unavailable (needs CONFIG_LOCK_STAT)\n",
+           LOCK_STAT_PATH);
+    return;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    if (strstr(line, "class name") || strstr(line, "led->lock") ||
+        strstr(line, "led->pm_lock") || strstr(line, "led->ctrl_lock"))
+      printf("  %s", line);
+  }
+  fclose(f);
+}
+
+static void clear_lock_stat(void) {
+  FILE *f = fopen(LOCK_STAT_PATH, "w");
+
+  if (f) {
+    fputs("0\n", f);
+    fclose(f);
+  }
+}
+
+static void run_round(const char *device, int threads, int seconds,
+                      TriggerSource *trigger) {
+  Worker *workers = calloc(threads, sizeof(*workers));
+  OpStats total[OP_COUNT] = {0};
+  unsigned long inconsistencies = 0, ops = 0;
+
+  clear_lock_stat();
+  atomic_store(&stop, false);
+
+  if (trigger) {
+    trigger->device = device;
+    trigger->edges = 0;
+    trigger->failed = 0;
+    pthread_create(&trigger->thread, NULL, trigger_main, trigger);
+  }
+
+  for (int i = 0; i < threads; i++) {
+    workers[i].device = device;
+    workers[i].seed = (unsigned int)now_ns() ^ (i * 2654435761U);
+    pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+  }
+
+  sleep(seconds);
+  atomic_store(&stop, true);
+
+  if (trigger)
+    pthread_join(trigger->thread, NULL);
+
+  for (int i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+    inconsistencies += workers[i].inconsistencies;
+    for (int op = 0; op < OP_COUNT; op++) {
+      OpStats *s = &workers[i].ops[op];
+      total[op].count += s->count;
+      total[op].errors += s->errors;
+      total[op].total_ns += s->total_ns;
+      if (s->max_ns > total[op].max_ns)
+        total[op].max_ns = s->max_ns;
+    }
+  }
+
+  for (int op = 0; op < OP_COUNT; op++)
+    ops += total[op].count;
+
+  printf("\n%d thread(s): %.0f ops/s, %lu inconsistencies, reset %s\n",
+         threads, (double)ops / seconds, inconsistencies,
+         check_quiescent(device) ? "LEAKED EDGES" : "clean");
+  if (trigger)
+    printf("  trigger  %10lu edges on GPIO %d%s\n", trigger->edges,
+           trigger->gpio, trigger->failed ? " (failed)" : "");
+
+  for (int op = 0; op < OP_COUNT; op++) {
+    OpStats *s = &total[op];
+    if (!s->count)
+      continue;
+    printf("  %-8s %10lu ops  avg %7.2f us  max %9.2f us  errors %lu\n",
+           op_names[op], s->count, s->total_ns / 1000.0 / s->count,
+           s->max_ns / 1000.0, s->errors);
+  }
+
+  print_lock_stat();
+  free(workers);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [-t gpio -p sim_pull_file] [max_threads] [seconds] "
+          "[device]\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  TriggerSource trigger = {.gpio = -1};
+  int max_threads, seconds, opt;
+  const char *device;
+
+  while ((opt = getopt(argc, argv, "t:p:h")) != -1) {
+    switch (opt) {
+    case 't':
+      trigger.gpio = atoi(optarg);
+      break;
+    case 'p':
+      trigger.pull_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  max_threads = argc > optind ? atoi(argv[optind]) : 8;
+  seconds = argc > optind + 1 ? atoi(argv[optind + 1]) : 5;
+  device = argc > optind + 2 ? argv[optind + 2] : DEVICE_PATH;
+
+  if (max_threads < 1 || seconds < 1 ||
+      (trigger.gpio >= 0) != (trigger.pull_path != NULL)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (access(device, R_OK | W_OK)) {
+    perror("Failed to open the device");
+    return 1;
+  }
+
+  // Double the thread count each round to show how throughput scales
+  for (int threads = 1; threads <= max_threads; threads *= 2)
+    run_round(device, threads, seconds, trigger.pull_path ? &trigger : NULL);
+
+  return 0;
+}
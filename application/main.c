@@ -1,4 +1,7 @@
-#include <fcntl.h>
+#include "gpio_trace.h"
+#include "led_backend.h"
+#include "pattern_import.h"
+#include <errno.h>
 #include <json-c/json.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,7 +9,6 @@
 #include <time.h>
 #include <unistd.h>
 
-#define DEVICE_PATH "/dev/led_controller"
 #define BUFFER_SIZE 64
 #define CONFIG_FILE "led_patterns.json"
 
@@ -28,35 +30,30 @@ void print_menu() {
   printf("8. Save Pattern\n");
   printf("9. Load Pattern\n");
   printf("0. System Monitor Mode\n");
+  printf("r. Replay Trace Capture\n");
   printf("q. Quit\n");
   printf("Choose an option: ");
 }
 
-void blink_led(int fd, int times, int delay_ms) {
-  char cmd;
+void blink_led(LedBackend *led, int times, int delay_ms) {
   for (int i = 0; i < times; i++) {
-    cmd = '1';
-    write(fd, &cmd, 1);
+    led_backend_set(led, 1);
     usleep(delay_ms * 1000);
-    cmd = '0';
-    write(fd, &cmd, 1);
+    led_backend_set(led, 0);
     usleep(delay_ms * 1000);
   }
 }
 
-void strobe_effect(int fd, int intensity) {
-  char cmd;
+void strobe_effect(LedBackend *led, int intensity) {
   for (int i = 0; i < intensity; i++) {
-    cmd = '1';
-    write(fd, &cmd, 1);
+    led_backend_set(led, 1);
     usleep(50000); // 50ms
-    cmd = '0';
-    write(fd, &cmd, 1);
+    led_backend_set(led, 0);
     usleep(20000); // 20ms
   }
 }
 
-void morse_code(int fd, const char *text) {
+void morse_code(LedBackend *led, const char *text) {
   const char *morse[] = {".-",   "-...", "-.-.", "-..",  ".",    "..-.", "--.",
                          "....", "..",   ".---", "-.-",  ".-..", "--",   "-.",
                          "---",  ".--.", "--.-", ".-.",  "...",  "-",    "..-",
@@ -66,11 +63,9 @@ void morse_code(int fd, const char *text) {
     if (text[i] >= 'a' && text[i] <= 'z') {
       const char *code = morse[text[i] - 'a'];
       for (int j = 0; code[j]; j++) {
-        char cmd = '1';
-        write(fd, &cmd, 1);
+        led_backend_set(led, 1);
         usleep(code[j] == '.' ? 100000 : 300000);
-        cmd = '0';
-        write(fd, &cmd, 1);
+        led_backend_set(led, 0);
         usleep(100000);
       }
       usleep(300000); // Letter spacing
@@ -96,16 +91,156 @@ void save_pattern(const char *name, const char *pattern, int delay) {
                          json_object_new_string(pattern));
   json_object_object_add(new_pattern, "delay", json_object_new_int(delay));
   json_object_array_add(patterns, new_pattern);
+  json_object_object_add(root, "patterns", patterns);
 
   // Save to file
   f = fopen(CONFIG_FILE, "w");
   fprintf(f, "%s",
           json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY));
   fclose(f);
+  json_object_put(root);
 }
 
-void system_monitor_mode(int fd) {
-  char cmd;
+typedef struct {
+  const char *name;
+  CompiledPattern pattern;
+  int found;
+} PatternLookup;
+
+static int find_pattern(const CompiledPattern *pattern, void *ctx) {
+  PatternLookup *lookup = ctx;
+
+  if (strcmp(pattern->name, lookup->name))
+    return 0;
+
+  lookup->pattern = *pattern;
+  lookup->found = 1;
+  return 1; // Stop at the first match
+}
+
+void load_pattern(LedBackend *led, const char *name) {
+  PatternLookup lookup = {.name = name};
+  ImportStats stats;
+
+  if (import_patterns(CONFIG_FILE, find_pattern, &lookup, &stats))
+    return;
+
+  if (!lookup.found) {
+    printf("Pattern '%s' not found (%lu valid, %lu rejected)\n", name,
+           stats.imported, stats.rejected);
+    return;
+  }
+
+  for (int i = 0; i < lookup.pattern.steps; i++) {
+    led_backend_set(led, pattern_step(&lookup.pattern, i));
+    usleep(lookup.pattern.delay * 1000);
+  }
+  led_backend_set(led, 0);
+}
+
+static int compare_trace_events(const void *a, const void *b) {
+  const struct led_trace_event *ea = a, *eb = b;
+  return (ea->ts_ns > eb->ts_ns) - (ea->ts_ns < eb->ts_ns);
+}
+
+// Replay a capture made by concatenating the driver's per-CPU files, e.g.
+//   cat /sys/kernel/debug/led_controller_trace/trace* > capture.bin
+// Every LED the backend drives is merged into one timeline, and all edges
+// due by the time an update goes out are batched into it. A non-negative
+// led restricts the replay to that LED.
+void replay_trace(LedBackend *backend, const char *path, int led) {
+  struct led_trace_event ev, *timeline = NULL;
+  size_t count = 0, capacity = 0, skipped = 0, updates = 0, failed = 0;
+  struct timespec start, target, now;
+  int err = 0;
+
+  if (led >= 0 && (unsigned int)led >= backend->num_leds) {
+    printf("Invalid LED index: %s drives LEDs 0-%u\n", backend->name,
+           backend->num_leds - 1);
+    return;
+  }
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror("Failed to open capture");
+    return;
+  }
+
+  while (fread(&ev, sizeof(ev), 1, f) == 1) {
+    if (led >= 0 && ev.led != led)
+      continue;
+    if (ev.led >= backend->num_leds) {
+      skipped++;
+      continue;
+    }
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      struct led_trace_event *grown =
+          realloc(timeline, capacity * sizeof(*timeline));
+      if (!grown) {
+        perror("Failed to load capture");
+        free(timeline);
+        fclose(f);
+        return;
+      }
+      timeline = grown;
+    }
+    timeline[count++] = ev;
+  }
+  fclose(f);
+
+  if (skipped)
+    fprintf(stderr, "Skipped %zu edges for LEDs beyond %s's %u\n", skipped,
+            backend->name, backend->num_leds);
+
+  // Per-CPU buffers interleave; restore the global order
+  qsort(timeline, count, sizeof(*timeline), compare_trace_events);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < count;) {
+    unsigned long long offset = timeline[i].ts_ns - timeline[0].ts_ns;
+    unsigned long long nsec = start.tv_nsec + offset % 1000000000ULL;
+    unsigned long long mask = 0, values = 0, due;
+
+    target.tv_sec =
+        start.tv_sec + offset / 1000000000ULL + nsec / 1000000000ULL;
+    target.tv_nsec = nsec % 1000000000ULL;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    due = (now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec -
+          start.tv_nsec;
+    if (due < offset)
+      due = offset;
+
+    // Later edges of the same LED in one batch win
+    for (; i < count && timeline[i].ts_ns - timeline[0].ts_ns <= due; i++) {
+      unsigned long long bit = 1ULL << timeline[i].led;
+
+      mask |= bit;
+      values = timeline[i].level ? values | bit : values & ~bit;
+    }
+
+    updates++;
+    if (backend->set_values(backend, mask, values)) {
+      err = errno;
+      failed++;
+    }
+  }
+
+  if (failed)
+    fprintf(stderr, "Failed %zu of %zu updates: %s\n", failed, updates,
+            strerror(err));
+  if (led >= 0)
+    printf("Replayed %zu edges for LED %d in %zu updates\n", count, led,
+           updates - failed);
+  else
+    printf("Replayed %zu edges across %u LEDs in %zu updates\n", count,
+           backend->num_leds, updates - failed);
+  free(timeline);
+}
+
+void system_monitor_mode(LedBackend *led) {
   FILE *cpu_info = fopen("/proc/stat", "r");
   while (1) {
     // Read CPU usage and blink LED accordingly
@@ -115,13 +250,11 @@ void system_monitor_mode(int fd) {
         (float)(user + nice + system) / (user + nice + system + idle) * 100;
 
     if (cpu_usage > 80) {
-      strobe_effect(fd, 5); // High CPU alert
+      strobe_effect(led, 5); // High CPU alert
     } else if (cpu_usage > 50) {
-      cmd = '1';
-      write(fd, &cmd, 1);
+      led_backend_set(led, 1);
       usleep(200000);
-      cmd = '0';
-      write(fd, &cmd, 1);
+      led_backend_set(led, 0);
       usleep(200000);
     }
 
@@ -132,19 +265,48 @@ void system_monitor_mode(int fd) {
   fclose(cpu_info);
 }
 
-int main() {
-  int fd;
+void print_usage(const char *prog) {
+  printf("Usage: %s [-b chardev|gpio] [-d device] [-l lines]\n", prog);
+  printf("  -b  Output backend (default: chardev)\n");
+  printf("  -d  Device path (default: %s, or %s for gpio)\n", DEVICE_PATH,
+         GPIO_CHIP_PATH);
+  printf("  -l  GPIO line offsets for the gpio backend, e.g. 17,18,27\n");
+}
+
+int main(int argc, char *argv[]) {
+  const char *backend_name = "chardev";
+  const char *device = NULL;
+  const char *lines = DEFAULT_GPIO_LINES;
+  LedBackend *led;
   char input[BUFFER_SIZE];
-  char cmd;
-  char status;
+  int status;
+  int opt;
 
-  fd = open(DEVICE_PATH, O_RDWR);
-  if (fd < 0) {
-    perror("Failed to open the device");
-    return 1;
+  while ((opt = getopt(argc, argv, "b:d:l:h")) != -1) {
+    switch (opt) {
+    case 'b':
+      backend_name = optarg;
+      break;
+    case 'd':
+      device = optarg;
+      break;
+    case 'l':
+      lines = optarg;
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
   }
 
-  printf("LED Controller Pro Max Started!\n");
+  if (!device)
+    device = strcmp(backend_name, "gpio") ? DEVICE_PATH : GPIO_CHIP_PATH;
+
+  led = led_backend_open(backend_name, device, lines);
+  if (!led)
+    return 1;
+
+  printf("LED Controller Pro Max Started! (%s backend)\n", led->name);
 
   while (1) {
     print_menu();
@@ -152,14 +314,12 @@ int main() {
 
     switch (input[0]) {
     case '1':
-      cmd = '1';
-      write(fd, &cmd, 1);
+      led_backend_set(led, 1);
       printf("LED turned ON\n");
       break;
 
     case '2':
-      cmd = '0';
-      write(fd, &cmd, 1);
+      led_backend_set(led, 0);
       printf("LED turned OFF\n");
       break;
 
@@ -170,12 +330,13 @@ int main() {
       printf("Enter delay (ms): ");
       fgets(input, BUFFER_SIZE, stdin);
       int delay = atoi(input);
-      blink_led(fd, blinks, delay);
+      blink_led(led, blinks, delay);
       break;
 
     case '4':
-      if (read(fd, &status, 1) > 0) {
-        printf("LED Status: %s\n", status == '1' ? "ON" : "OFF");
+      status = led->get_value(led);
+      if (status >= 0) {
+        printf("LED Status: %s\n", status ? "ON" : "OFF");
       } else {
         printf("Failed to read LED status\n");
       }
@@ -186,7 +347,7 @@ int main() {
       fgets(input, BUFFER_SIZE, stdin);
       for (int i = 0; input[i] != '\n' && input[i] != '\0'; i++) {
         if (input[i] == '1' || input[i] == '0') {
-          write(fd, &input[i], 1);
+          led_backend_set(led, input[i] == '1');
           usleep(500000); // 500ms delay
         }
       }
@@ -195,14 +356,14 @@ int main() {
     case '6':
       printf("Enter strobe intensity (1-10): ");
       fgets(input, BUFFER_SIZE, stdin);
-      strobe_effect(fd, atoi(input));
+      strobe_effect(led, atoi(input));
       break;
 
     case '7':
       printf("Enter text for morse code: ");
       fgets(input, BUFFER_SIZE, stdin);
       input[strcspn(input, "\n")] = 0;
-      morse_code(fd, input);
+      morse_code(led, input);
       break;
 
     case '8':
@@ -217,15 +378,29 @@ int main() {
       break;
 
     case '9':
-      // Pattern loading logic
+      printf("Enter pattern name: ");
+      fgets(input, BUFFER_SIZE, stdin);
+      input[strcspn(input, "\n")] = 0;
+      load_pattern(led, input);
       break;
 
     case '0':
-      system_monitor_mode(fd);
+      system_monitor_mode(led);
+      break;
+
+    case 'r':
+      printf("Enter capture file: ");
+      fgets(input, BUFFER_SIZE, stdin);
+      input[strcspn(input, "\n")] = 0;
+      char capture[BUFFER_SIZE];
+      strcpy(capture, input);
+      printf("Enter LED index (blank for all): ");
+      fgets(input, BUFFER_SIZE, stdin);
+      replay_trace(led, capture, input[0] == '\n' ? -1 : atoi(input));
       break;
 
     case 'q':
-      close(fd);
+      led->close(led);
       printf("Goodbye!\n");
       return 0;
 
@@ -0,0 +1,91 @@
+#include "pattern_import.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+// Import throughput and peak RSS for a large pattern library. A library
+// of the requested size is generated first if the file does not exist;
+// about one entry in a hundred is deliberately invalid.
+//
+//   pattern_bench [library.json] [size_mb]
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int generate_library(const char *path, long size_mb) {
+  long target = size_mb * 1024 * 1024;
+  unsigned int seed = 1;
+  char steps[257];
+  long written = 0;
+  int n = 0;
+
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror("Failed to create library");
+    return -1;
+  }
+
+  written += fprintf(f, "{\n  \"patterns\": [\n");
+  while (written < target) {
+    int len = 16 + rand_r(&seed) % 240;
+    for (int i = 0; i < len; i++)
+      steps[i] = '0' + (rand_r(&seed) & 1);
+    steps[len] = '\0';
+    if (n % 100 == 99)
+      steps[len / 2] = 'x';
+
+    written += fprintf(f,
+                       "%s    {\"name\": \"pattern-%d\", \"pattern\": \"%s\", "
+                       "\"delay\": %d}",
+                       n ? ",\n" : "", n, steps, 10 + rand_r(&seed) % 500);
+    n++;
+  }
+  fprintf(f, "\n  ]\n}\n");
+  fclose(f);
+
+  printf("Generated %s: %d patterns, %.1f MB\n", path, n,
+         written / 1048576.0);
+  return 0;
+}
+
+static int count_pattern(const CompiledPattern *pattern, void *ctx) {
+  unsigned long *steps = ctx;
+
+  *steps += pattern->steps;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = argc > 1 ? argv[1] : "bench_patterns.json";
+  long size_mb = argc > 2 ? atol(argv[2]) : 50;
+  unsigned long steps = 0;
+  struct rusage usage;
+  ImportStats stats;
+  double start, elapsed;
+
+  if (access(path, R_OK) && generate_library(path, size_mb))
+    return 1;
+
+  // Rejected entries are expected; keep the report readable
+  if (!freopen("/dev/null", "w", stderr))
+    return 1;
+
+  start = now_s();
+  if (import_patterns(path, count_pattern, &steps, &stats))
+    return 1;
+  elapsed = now_s() - start;
+
+  getrusage(RUSAGE_SELF, &usage);
+  printf("Imported %lu patterns (%lu steps), rejected %lu\n", stats.imported,
+         steps, stats.rejected);
+  printf("%.1f MB in %.2f s: %.1f MB/s, peak RSS %ld KB\n",
+         stats.bytes / 1048576.0, elapsed, stats.bytes / 1048576.0 / elapsed,
+         usage.ru_maxrss);
+
+  return 0;
+}
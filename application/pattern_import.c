@@ -0,0 +1,283 @@
+#include "pattern_import.h"
+#include <ctype.h>
+#include <json-c/json.h>
+#include <stdio.h>
+#include <string.h>
+
+// Input is read in fixed chunks and only the entry being parsed is held by
+// the tokener, so memory use does not depend on the library size
+#define CHUNK_SIZE (64 * 1024)
+#define ENTRY_MAX (256 * 1024)
+#define DELAY_MAX_MS 60000
+
+enum scan_state {
+  SCAN_SEEK_ARRAY, // Looking for the patterns array
+  SCAN_SEEK_ENTRY, // Between entries
+  SCAN_ENTRY,      // Inside an entry
+  SCAN_DONE,
+};
+
+typedef struct {
+  enum scan_state state;
+  int depth;
+  int in_string;
+  int escape;
+  char key[16]; // Last string seen at depth 1, to find "patterns"
+  size_t key_len;
+  unsigned long index;
+  size_t entry_bytes;
+  const char *entry_error;
+  json_object *entry; // Set once the tokener completes the entry
+  json_tokener *tok;
+  const char *path;
+  PatternHandler handler;
+  void *ctx;
+  ImportStats *stats;
+} Importer;
+
+// Strip the trailing newline fgets() leaves in saved names and patterns
+static size_t trimmed_len(const char *s, size_t len) {
+  while (len && (s[len - 1] == '\n' || s[len - 1] == '\r'))
+    len--;
+  return len;
+}
+
+static const char *compile_pattern(json_object *obj, CompiledPattern *out) {
+  json_object *name, *pattern, *delay;
+  const char *s;
+  size_t len;
+
+  if (!json_object_is_type(obj, json_type_object))
+    return "not an object";
+
+  if (!json_object_object_get_ex(obj, "name", &name) ||
+      !json_object_is_type(name, json_type_string))
+    return "missing name";
+  s = json_object_get_string(name);
+  len = trimmed_len(s, json_object_get_string_len(name));
+  if (!len || len >= PATTERN_NAME_MAX)
+    return "name empty or too long";
+  memcpy(out->name, s, len);
+  out->name[len] = '\0';
+
+  if (!json_object_object_get_ex(obj, "pattern", &pattern) ||
+      !json_object_is_type(pattern, json_type_string))
+    return "missing pattern";
+  s = json_object_get_string(pattern);
+  len = trimmed_len(s, json_object_get_string_len(pattern));
+  if (!len || len > PATTERN_STEPS_MAX)
+    return "pattern empty or too long";
+
+  memset(out->bits, 0, sizeof(out->bits));
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] == '1')
+      out->bits[i / 8] |= 1 << (i % 8);
+    else if (s[i] != '0')
+      return "pattern must contain only 0 and 1";
+  }
+  out->steps = len;
+
+  if (!json_object_object_get_ex(obj, "delay", &delay) ||
+      !json_object_is_type(delay, json_type_int))
+    return "missing delay";
+  out->delay = json_object_get_int(delay);
+  if (out->delay < 1 || out->delay > DELAY_MAX_MS)
+    return "delay out of range";
+
+  return NULL;
+}
+
+static void finish_entry(Importer *im) {
+  CompiledPattern pattern;
+
+  if (!im->entry_error) {
+    if (!im->entry)
+      im->entry_error = "incomplete entry";
+    else
+      im->entry_error = compile_pattern(im->entry, &pattern);
+  }
+
+  if (im->entry_error) {
+    fprintf(stderr, "%s: entry %lu rejected: %s\n", im->path, im->index,
+            im->entry_error);
+    im->stats->rejected++;
+  } else {
+    im->stats->imported++;
+    if (im->handler(&pattern, im->ctx))
+      im->state = SCAN_DONE;
+  }
+
+  json_object_put(im->entry);
+  im->entry = NULL;
+  json_tokener_reset(im->tok);
+  if (im->state != SCAN_DONE)
+    im->state = SCAN_SEEK_ENTRY;
+}
+
+static void seek_array(Importer *im, char c) {
+  if (im->in_string) {
+    if (im->escape)
+      im->escape = 0;
+    else if (c == '\\')
+      im->escape = 1;
+    else if (c == '"')
+      im->in_string = 0;
+    else if (im->depth == 1 && im->key_len < sizeof(im->key) - 1)
+      im->key[im->key_len++] = c;
+    im->key[im->key_len] = '\0';
+    return;
+  }
+
+  switch (c) {
+  case '"':
+    im->in_string = 1;
+    im->key_len = 0;
+    break;
+  case '[':
+    if (im->depth == 0 || (im->depth == 1 && !strcmp(im->key, "patterns"))) {
+      im->state = SCAN_SEEK_ENTRY;
+      return;
+    }
+    im->depth++;
+    break;
+  case '{':
+    im->depth++;
+    break;
+  case '}':
+  case ']':
+    im->depth--;
+    break;
+  }
+}
+
+// Find where the current entry ends in buf, tracking nesting ourselves so
+// a malformed entry can be skipped without losing our place
+static size_t scan_entry(Importer *im, const char *buf, size_t len,
+                         int *done) {
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    char c = buf[i];
+
+    if (im->in_string) {
+      if (im->escape)
+        im->escape = 0;
+      else if (c == '\\')
+        im->escape = 1;
+      else if (c == '"')
+        im->in_string = 0;
+      continue;
+    }
+
+    if (im->depth == 0 && (c == ',' || c == ']')) {
+      *done = 1; // End of a scalar entry; leave the separator
+      return i;
+    }
+    if (c == '"') {
+      im->in_string = 1;
+    } else if (c == '{' || c == '[') {
+      im->depth++;
+    } else if (c == '}' && im->depth == 0) {
+      *done = 1; // Unmatched closer ends the bad entry; consume it
+      return i + 1;
+    } else if (c == '}' || c == ']') {
+      if (--im->depth == 0) {
+        *done = 1;
+        return i + 1;
+      }
+    }
+  }
+
+  return i;
+}
+
+static void scan_chunk(Importer *im, const char *buf, size_t len) {
+  size_t i = 0;
+
+  while (i < len && im->state != SCAN_DONE) {
+    if (im->state == SCAN_SEEK_ARRAY) {
+      seek_array(im, buf[i++]);
+      continue;
+    }
+
+    if (im->state == SCAN_SEEK_ENTRY) {
+      char c = buf[i];
+
+      if (c == ']') {
+        im->state = SCAN_DONE;
+      } else if (!isspace((unsigned char)c) && c != ',') {
+        im->state = SCAN_ENTRY;
+        im->index++;
+        im->depth = 0;
+        im->in_string = im->escape = 0;
+        im->entry_bytes = 0;
+        im->entry_error = c == '{'   ? NULL
+                          : c == '}' ? "unmatched '}'"
+                                     : "not an object";
+        continue;
+      }
+      i++;
+      continue;
+    }
+
+    int done = 0;
+    size_t n = scan_entry(im, buf + i, len - i, &done);
+
+    im->entry_bytes += n;
+    if (!im->entry_error && im->entry_bytes > ENTRY_MAX) {
+      im->entry_error = "entry too large";
+      json_tokener_reset(im->tok);
+    }
+
+    if (!im->entry_error && n) {
+      enum json_tokener_error err;
+
+      im->entry = json_tokener_parse_ex(im->tok, buf + i, n);
+      err = json_tokener_get_error(im->tok);
+      if (err != json_tokener_success && err != json_tokener_continue)
+        im->entry_error = json_tokener_error_desc(err);
+    }
+
+    i += n;
+    if (done)
+      finish_entry(im);
+  }
+}
+
+int import_patterns(const char *path, PatternHandler handler, void *ctx,
+                    ImportStats *stats) {
+  static char chunk[CHUNK_SIZE];
+  Importer im = {0};
+  size_t n;
+  int ret = 0;
+
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror("Failed to open pattern library");
+    return -1;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  im.tok = json_tokener_new();
+  im.path = path;
+  im.handler = handler;
+  im.ctx = ctx;
+  im.stats = stats;
+
+  while (im.state != SCAN_DONE && (n = fread(chunk, 1, sizeof(chunk), f))) {
+    stats->bytes += n;
+    scan_chunk(&im, chunk, n);
+  }
+
+  if (im.state == SCAN_SEEK_ARRAY) {
+    fprintf(stderr, "%s: no pattern array found\n", path);
+    ret = -1;
+  } else if (im.state == SCAN_ENTRY) {
+    im.entry_error = "truncated entry";
+    finish_entry(&im);
+  }
+
+  json_tokener_free(im.tok);
+  fclose(f);
+  return ret;
+}
@@ -0,0 +1,37 @@
+#ifndef PATTERN_IMPORT_H
+#define PATTERN_IMPORT_H
+
+#include <stddef.h>
+
+#define PATTERN_NAME_MAX 32
+#define PATTERN_STEPS_MAX 4096
+
+// A validated pattern compiled to one bit per step
+typedef struct {
+  char name[PATTERN_NAME_MAX];
+  unsigned char bits[PATTERN_STEPS_MAX / 8];
+  int steps;
+  int delay;
+} CompiledPattern;
+
+typedef struct {
+  size_t bytes;
+  unsigned long imported;
+  unsigned long rejected;
+} ImportStats;
+
+// Called for every valid pattern; return nonzero to stop the import
+typedef int (*PatternHandler)(const CompiledPattern *pattern, void *ctx);
+
+// Stream a pattern library ({"patterns": [...]} or a bare array) through
+// handler without building the whole document. Bad entries are reported
+// on stderr and skipped. Returns 0, or -1 if the file cannot be read or
+// holds no pattern array.
+int import_patterns(const char *path, PatternHandler handler, void *ctx,
+                    ImportStats *stats);
+
+static inline int pattern_step(const CompiledPattern *p, int i) {
+  return (p->bits[i / 8] >> (i % 8)) & 1;
+}
+
+#endif // PATTERN_IMPORT_H
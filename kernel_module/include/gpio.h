@@ -1,8 +0,0 @@
-#ifndef GPIO_H
-#define GPIO_H
-
-// You can add any necessary definitions or function prototypes here
-// For example, if you want to share some definitions between the kernel module
-// and user-space application
-
-#endif
@@ -1,10 +1,12 @@
 #ifndef GPIO_DEBUGFS_H
 #define GPIO_DEBUGFS_H
 
-#include "gpio.h"
 #include <linux/debugfs.h>
 
+struct gpio_led_data; // src/gpio.h
+
 void led_debugfs_init(struct gpio_led_data *led);
 void led_debugfs_remove(struct gpio_led_data *led);
+void led_debugfs_cleanup(void);
 
 #endif // GPIO_DEBUGFS_H
@@ -0,0 +1,60 @@
+#ifndef GPIO_IOCTL_H
+#define GPIO_IOCTL_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#ifndef __KERNEL__
+#include <stdbool.h>
+#endif
+
+// Char device interface, shared by the kernel module and user-space tools
+
+// IOCTL commands
+#define LED_IOC_MAGIC 'L'
+#define LED_SET_BRIGHTNESS _IOW(LED_IOC_MAGIC, 1, int)
+#define LED_SET_BLINK _IOW(LED_IOC_MAGIC, 2, struct led_blink_params)
+#define LED_RESET _IO(LED_IOC_MAGIC, 3)
+
+// Additional IOCTL commands
+#define LED_SET_PWM _IOW(LED_IOC_MAGIC, 4, struct pwm_params)
+#define LED_GET_STATS _IOR(LED_IOC_MAGIC, 5, struct led_stats)
+#define LED_SET_TRIGGER _IOW(LED_IOC_MAGIC, 6, struct trigger_params)
+#define LED_SET_THERMAL _IOW(LED_IOC_MAGIC, 7, struct thermal_params)
+
+struct led_blink_params {
+  unsigned int delay_on;
+  unsigned int delay_off;
+};
+
+struct pwm_params {
+  unsigned int period_ns;
+  unsigned int duty_cycle;
+  bool hardware_pwm;
+};
+
+// Fixed-width so 32-bit user space sees the same layout and ioctl number
+struct led_stats {
+  __u64 switches;
+  __u64 pwm_changes;
+  __u64 errors;
+  __u64 uptime;
+  __u64 power_cycles;
+  __u64 on_time_ns;
+  __u64 duty_time_ns;
+  __u64 energy_uj;
+};
+
+struct trigger_params {
+  int gpio_trigger;
+  bool rising_edge;
+  bool falling_edge;
+  unsigned int debounce_ms;
+};
+
+struct thermal_params {
+  int temp_threshold;
+  int hysteresis;
+  bool auto_throttle;
+};
+
+#endif // GPIO_IOCTL_H
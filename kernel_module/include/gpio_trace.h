@@ -0,0 +1,33 @@
+#ifndef GPIO_TRACE_H
+#define GPIO_TRACE_H
+
+#include <linux/types.h>
+
+// What caused an output change
+enum led_trace_source {
+  LED_TRACE_WRITE,
+  LED_TRACE_IOCTL,
+  LED_TRACE_BLINK,
+  LED_TRACE_TRIGGER,
+  LED_TRACE_THERMAL,
+  LED_TRACE_PM,
+  LED_TRACE_BENCH,
+};
+
+// One record per output change, streamed from the per-CPU debugfs files
+// led_controller_trace/trace<cpu>. Shared with the user-space replayer.
+struct led_trace_event {
+  __u64 ts_ns; // CLOCK_MONOTONIC
+  __u8 led;
+  __u8 level;
+  __u8 source;
+  __u8 pad[5];
+};
+
+#ifdef __KERNEL__
+int led_trace_init(void);
+void led_trace_remove(void);
+void led_trace_record(int led, int level, enum led_trace_source source);
+#endif
+
+#endif // GPIO_TRACE_H
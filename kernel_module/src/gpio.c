@@ -1,22 +1,26 @@
 #include "gpio.h"
 #include "gpio_debugfs.h"
+#include "gpio_trace.h"
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/gpio.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_gpio.h>
 #include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
 #include <linux/printk.h>
 #include <linux/pwm.h>
 #include <linux/slab.h>
 #include <linux/thermal.h>
 #include <linux/timer.h>
 #include <linux/uaccess.h>
+#include <linux/workqueue.h>
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Sandesh Ghimire");
@@ -29,6 +33,39 @@ static dev_t dev_num;
 static struct class *device_class;
 static struct cdev gpio_cdev;
 
+static unsigned int autosuspend_delay_ms = 2000;
+module_param(autosuspend_delay_ms, uint, 0444);
+MODULE_PARM_DESC(autosuspend_delay_ms,
+                 "Idle time before the controller runtime suspends (ms)");
+
+// Estimated draw of lit LEDs that cannot be dimmed and of hardware PWM
+// LEDs, and the brightness scale (percent) applied to the PWM outputs to
+// keep the sum within power_budget_mw
+static atomic_t fixed_draw_mw = ATOMIC_INIT(0);
+static atomic_t pwm_draw_mw = ATOMIC_INIT(0);
+static unsigned int budget_scale = 100;
+static void power_budget_work(struct work_struct *work);
+static DECLARE_WORK(budget_work, power_budget_work);
+
+static unsigned int power_budget_mw = 0;
+
+// Rebalance as soon as the budget changes, not at the next draw change
+static int power_budget_set(const char *val, const struct kernel_param *kp) {
+  int ret = param_set_uint(val, kp);
+
+  if (!ret)
+    schedule_work(&budget_work);
+  return ret;
+}
+
+static const struct kernel_param_ops power_budget_ops = {
+    .set = power_budget_set,
+    .get = param_get_uint,
+};
+module_param_cb(power_budget_mw, &power_budget_ops, &power_budget_mw, 0644);
+MODULE_PARM_DESC(power_budget_mw,
+                 "Controller-wide LED power budget in mW (0 = unlimited)");
+
 // Function prototypes
 static int led_open(struct inode *inode, struct file *file);
 static int led_close(struct inode *inode, struct file *file);
@@ -40,8 +77,12 @@ static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 static void blink_timer_callback(struct timer_list *t);
 static void thermal_check_work(struct work_struct *work);
 static irqreturn_t led_trigger_handler(int irq, void *dev_id);
+static int led_set_trigger(struct gpio_led_data *led,
+                           const struct trigger_params *params);
 static int led_suspend(struct device *dev);
 static int led_resume(struct device *dev);
+static int led_runtime_suspend(struct device *dev);
+static int led_runtime_resume(struct device *dev);
 
 // Enhanced file operations
 static struct file_operations fops = {
@@ -55,10 +96,356 @@ static struct file_operations fops = {
 
 // Open function
 static int led_open(struct inode *inode, struct file *file) {
+  unsigned int minor = iminor(inode);
+
+  if (minor >= num_gpios || !led_data[minor])
+    return -ENODEV;
+
+  file->private_data = led_data[minor];
   printk(KERN_INFO "%s: Device opened\n", DEVICE_NAME);
   return 0;
 }
 
+// Output fast paths, picked once per LED at probe from its capabilities so
+// a toggle is one indirect call with no per-event checks. The GPIO gates
+// the LED on and off; where hardware PWM exists it only sets intensity.
+static void led_gpio_set(struct gpio_led_data *led, int level) {
+  gpio_set_value(led->gpio_pin, level);
+}
+
+// Expander GPIOs can sleep: hand the latest level to a worker
+static void led_gpio_sleep_set(struct gpio_led_data *led, int level) {
+  WRITE_ONCE(led->pending_level, level);
+  queue_work(system_highpri_wq, &led->output_work);
+}
+
+static void led_output_work(struct work_struct *work) {
+  struct gpio_led_data *led =
+      container_of(work, struct gpio_led_data, output_work);
+
+  gpio_set_value_cansleep(led->gpio_pin, READ_ONCE(led->pending_level));
+}
+
+// Hardware PWM: the GPIO gates the LED and the PWM carries brightness
+// scaled by the power budget. Duty changes are programmed from process
+// context; lighting an LED whose duty is stale schedules that.
+static unsigned int led_pwm_target(struct gpio_led_data *led) {
+  unsigned int duty = READ_ONCE(led->brightness);
+
+  return (duty ? duty : 100) * READ_ONCE(budget_scale) / 100;
+}
+
+static void led_pwm_apply(struct gpio_led_data *led) {
+  unsigned int duty;
+
+  mutex_lock(&led->pm_lock);
+  duty = led_pwm_target(led);
+  if (duty != led->pwm_duty) {
+    pwm_config(led->pwm, div_u64((u64)led->pwm_period_ns * duty, 100),
+               led->pwm_period_ns);
+    WRITE_ONCE(led->pwm_duty, duty);
+    led->stats.pwm_changes++;
+  }
+  mutex_unlock(&led->pm_lock);
+}
+
+static void led_pwm_work(struct work_struct *work) {
+  led_pwm_apply(container_of(work, struct gpio_led_data, pwm_work));
+}
+
+static void led_pwm_refresh(struct gpio_led_data *led, int level) {
+  if (level && READ_ONCE(led->pwm_duty) != led_pwm_target(led))
+    queue_work(system_highpri_wq, &led->pwm_work);
+}
+
+static void led_pwm_set(struct gpio_led_data *led, int level) {
+  led_gpio_set(led, level);
+  led_pwm_refresh(led, level);
+}
+
+static void led_pwm_sleep_set(struct gpio_led_data *led, int level) {
+  led_gpio_sleep_set(led, level);
+  led_pwm_refresh(led, level);
+}
+
+static const unsigned int full_scale = 100;
+
+static const struct led_output_ops led_gpio_ops = {
+    .name = "gpio",
+    .set = led_gpio_set,
+    .duty_scale = &full_scale,
+};
+
+static const struct led_output_ops led_gpio_sleep_ops = {
+    .name = "gpio-sleep",
+    .set = led_gpio_sleep_set,
+    .duty_scale = &full_scale,
+};
+
+static const struct led_output_ops led_pwm_ops = {
+    .name = "pwm",
+    .set = led_pwm_set,
+    .duty_scale = &budget_scale,
+    .dims = true,
+};
+
+static const struct led_output_ops led_pwm_sleep_ops = {
+    .name = "pwm-sleep",
+    .set = led_pwm_sleep_set,
+    .duty_scale = &budget_scale,
+    .dims = true,
+};
+
+static const struct led_output_ops *led_classify(struct gpio_led_data *led) {
+  bool sleeps = gpio_cansleep(led->gpio_pin);
+
+  if (led->hardware_pwm)
+    return sleeps ? &led_pwm_sleep_ops : &led_pwm_ops;
+
+  return sleeps ? &led_gpio_sleep_ops : &led_gpio_ops;
+}
+
+// An LED is idle when it is dark and has no pattern running
+static bool led_is_idle(struct gpio_led_data *led) {
+  return !test_bit(LED_FLAG_ON, &led->flags) &&
+         !test_bit(LED_FLAG_BLINKING, &led->flags);
+}
+
+// Level the output should have given the current state word
+static int led_level(struct gpio_led_data *led) {
+  return (READ_ONCE(led->flags) & LED_LEVEL_MASK) == BIT(LED_FLAG_ON);
+}
+
+// Nominal output duty in percent: 0 when dark, brightness when the
+// output can dim, otherwise fully lit
+static unsigned int led_duty(struct gpio_led_data *led) {
+  if (!led_level(led))
+    return 0;
+  if (!led->ops->dims || !led->brightness)
+    return 100;
+
+  return led->brightness;
+}
+
+// Close the accounting interval at the duty that was in effect since the
+// last transition and latch the new one. Called with led->lock held after
+// every output change, so an LED that does not change costs nothing.
+static void led_account(struct gpio_led_data *led) {
+  u64 now = ktime_get_ns();
+  u64 delta = now - led->last_change_ns;
+  unsigned int duty = led_duty(led);
+  unsigned int draw = led->power_mw * duty / 100;
+
+  if (led->cur_duty) {
+    led->on_time_ns += delta;
+    led->duty_time_ns += div_u64(delta * led->cur_duty, 100);
+  }
+  led->last_change_ns = now;
+
+  // Only hardware PWM outputs are actually dimmed by the budget
+  led->cur_duty = duty * READ_ONCE(*led->ops->duty_scale) / 100;
+
+  if (draw != led->draw_mw) {
+    atomic_add((int)draw - (int)led->draw_mw,
+               led->ops->dims ? &pwm_draw_mw : &fixed_draw_mw);
+    led->draw_mw = draw;
+    // Also rebalance while scaled down, so lifting the budget restores it
+    if (READ_ONCE(power_budget_mw) || READ_ONCE(budget_scale) != 100)
+      schedule_work(&budget_work);
+  }
+}
+
+// Rescale hardware PWM outputs when the total draw crosses the budget.
+// Only PWM LEDs can give anything back, so they share what the fixed
+// draw leaves over.
+static void power_budget_work(struct work_struct *work) {
+  unsigned int fixed = atomic_read(&fixed_draw_mw);
+  unsigned int dimmable = atomic_read(&pwm_draw_mw);
+  unsigned int budget = READ_ONCE(power_budget_mw);
+  unsigned int scale = 100;
+  struct gpio_led_data *led;
+  unsigned long flags;
+  int i;
+
+  if (budget && dimmable && fixed + dimmable > budget) {
+    if (fixed >= budget)
+      scale = 1;
+    else
+      scale = clamp((budget - fixed) * 100 / dimmable, 1U, 100U);
+  }
+
+  if (scale == budget_scale)
+    return;
+
+  WRITE_ONCE(budget_scale, scale);
+
+  // Dark PWM LEDs pick the new scale up when they next light
+  for (i = 0; i < num_gpios; i++) {
+    led = led_data[i];
+    if (!led || !led->hardware_pwm || !READ_ONCE(led->out_level))
+      continue;
+
+    led_pwm_apply(led);
+
+    spin_lock_irqsave(&led->lock, flags);
+    led_account(led);
+    spin_unlock_irqrestore(&led->lock, flags);
+  }
+}
+
+// Bring the GPIO in line with the state word. Writers flip bits in
+// led->flags atomically and then call this; the lock only serialises the
+// edge itself and its accounting, and redundant updates emit no edge.
+static void led_sync_output(struct gpio_led_data *led,
+                            enum led_trace_source source) {
+  unsigned long flags;
+  int level;
+
+  spin_lock_irqsave(&led->lock, flags);
+  level = led_level(led);
+  if (level != led->out_level) {
+    led->ops->set(led, level);
+    led_trace_record(led->index, level, source);
+    led->out_level = level;
+    led->stats.switches++;
+
+    if (unlikely(led->resume_ns)) {
+      led->resume_edge_ns = ktime_get_ns() - led->resume_ns;
+      led->resume_ns = 0;
+    }
+  }
+  led_account(led);
+  spin_unlock_irqrestore(&led->lock, flags);
+}
+
+// The output step as it was before LEDs were classified: the level from
+// three separate bit tests and gpio_set_value() whatever the output.
+// Only the debugfs toggle_bench file runs it, as the baseline for
+// led_sync_output(); accounting is shared so just the dispatch differs.
+static int led_level_legacy(struct gpio_led_data *led) {
+  return test_bit(LED_FLAG_ON, &led->flags) &&
+         !test_bit(LED_FLAG_THERMAL, &led->flags) &&
+         !test_bit(LED_FLAG_SUSPENDED, &led->flags);
+}
+
+// The old step called gpio_set_value() on every line. Sleeping lines
+// (expanders, gpio-sim) cannot take that under the spinlock, so there the
+// bench substitutes the worker hand-off; sleeps is a constant per loop.
+static __always_inline void
+led_sync_output_legacy(struct gpio_led_data *led,
+                       enum led_trace_source source, bool sleeps) {
+  unsigned long flags;
+  int level;
+
+  spin_lock_irqsave(&led->lock, flags);
+  level = led_level_legacy(led);
+  if (level != led->out_level) {
+    if (sleeps)
+      led_gpio_sleep_set(led, level);
+    else
+      gpio_set_value(led->gpio_pin, level);
+    led_trace_record(led->index, level, source);
+    led->out_level = level;
+    led->stats.switches++;
+  }
+  led_account(led);
+  spin_unlock_irqrestore(&led->lock, flags);
+}
+
+static void led_bench_legacy(struct gpio_led_data *led, unsigned int n,
+                             bool sleeps) {
+  unsigned int i;
+
+  for (i = 0; i < n; i++) {
+    change_bit(LED_FLAG_ON, &led->flags);
+    led_sync_output_legacy(led, LED_TRACE_BENCH, sleeps);
+  }
+}
+
+// Toggle the LED n times through each output step and time the loops.
+// On sleeping lines both time the hand-off; the worker runs untimed.
+int led_toggle_bench(struct gpio_led_data *led, unsigned int n,
+                     u64 *legacy_ns, u64 *ops_ns) {
+  bool was_on;
+  unsigned int i;
+  u64 start;
+
+  mutex_lock(&led->ctrl_lock);
+  was_on = test_bit(LED_FLAG_ON, &led->flags);
+
+  start = ktime_get_ns();
+  if (gpio_cansleep(led->gpio_pin))
+    led_bench_legacy(led, n, true);
+  else
+    led_bench_legacy(led, n, false);
+  *legacy_ns = ktime_get_ns() - start;
+  flush_work(&led->output_work);
+
+  start = ktime_get_ns();
+  for (i = 0; i < n; i++) {
+    change_bit(LED_FLAG_ON, &led->flags);
+    led_sync_output(led, LED_TRACE_BENCH);
+  }
+  *ops_ns = ktime_get_ns() - start;
+  flush_work(&led->output_work);
+
+  assign_bit(LED_FLAG_ON, &led->flags, was_on);
+  led_sync_output(led, LED_TRACE_BENCH);
+  mutex_unlock(&led->ctrl_lock);
+
+  return 0;
+}
+
+// Snapshot the LED's counters, closing the accounting interval still open
+void led_get_stats(struct gpio_led_data *led, struct led_stats *stats) {
+  unsigned long flags;
+
+  spin_lock_irqsave(&led->lock, flags);
+  led_account(led);
+  *stats = led->stats;
+  stats->uptime = div_u64(ktime_get_ns() - led->probe_ns, NSEC_PER_SEC);
+  stats->on_time_ns = led->on_time_ns;
+  stats->duty_time_ns = led->duty_time_ns;
+  spin_unlock_irqrestore(&led->lock, flags);
+
+  // mW x us = nJ
+  stats->energy_uj = div_u64(
+      div_u64(stats->duty_time_ns, NSEC_PER_USEC) * led->power_mw, 1000);
+}
+
+// Take or drop the LED's runtime PM reference to match its activity.
+// Must be called from process context after any state change.
+static void led_pm_update(struct gpio_led_data *led) {
+  bool idle;
+
+  mutex_lock(&led->pm_lock);
+  idle = led_is_idle(led);
+
+  if (!idle && !led->pm_active) {
+    pm_runtime_get_sync(led->dev);
+    WRITE_ONCE(led->pm_active, true);
+
+    if (led->pwm_released && !test_bit(LED_FLAG_THERMAL, &led->flags)) {
+      pwm_enable(led->pwm);
+      led->pwm_released = false;
+    }
+    if (led->thermal.auto_throttle)
+      schedule_delayed_work(&led->work, HZ);
+  } else if (idle && led->pm_active) {
+    WRITE_ONCE(led->pm_active, false);
+    cancel_delayed_work(&led->work);
+
+    // Idle LEDs give their PWM back without waiting for the controller
+    if (led->hardware_pwm && !led->pwm_released) {
+      pwm_disable(led->pwm);
+      led->pwm_released = true;
+    }
+    pm_runtime_mark_last_busy(led->dev);
+    pm_runtime_put_autosuspend(led->dev);
+  }
+  mutex_unlock(&led->pm_lock);
+}
+
 // Close function
 static int led_close(struct inode *inode, struct file *file) {
   printk(KERN_INFO "%s: Device closed\n", DEVICE_NAME);
@@ -68,8 +455,9 @@ static int led_close(struct inode *inode, struct file *file) {
 // Read function (returns current LED state)
 static ssize_t led_read(struct file *file, char __user *buf, size_t count,
                         loff_t *offset) {
+  struct gpio_led_data *led = file->private_data;
   char state_str[2];
-  sprintf(state_str, "%d", led_state);
+  sprintf(state_str, "%d", test_bit(LED_FLAG_ON, &led->flags));
   size_t len = strlen(state_str);
 
   if (*offset >= len)
@@ -82,14 +470,15 @@ static ssize_t led_read(struct file *file, char __user *buf, size_t count,
     return -EFAULT;
 
   *offset += count;
-  printk(KERN_INFO "%s: Read %zu bytes, offset = %lld\n", DEVICE_NAME, count,
-         *offset);
+  pr_debug("%s: Read %zu bytes, offset = %lld\n", DEVICE_NAME, count,
+           *offset);
   return count;
 }
 
 // Write function (to control the LED)
 static ssize_t led_write(struct file *file, const char __user *buf,
                          size_t count, loff_t *offset) {
+  struct gpio_led_data *led = file->private_data;
   char kbuf[2];
 
   if (count > 1)
@@ -99,13 +488,17 @@ static ssize_t led_write(struct file *file, const char __user *buf,
     return -EFAULT;
 
   if (kbuf[0] == '1') {
-    gpio_set_value(gpio_pin, 1);
-    led_state = 1;
-    printk(KERN_INFO "%s: LED ON\n", DEVICE_NAME);
+    if (!test_and_set_bit(LED_FLAG_ON, &led->flags)) {
+      led_sync_output(led, LED_TRACE_WRITE);
+      led_pm_update(led);
+    }
+    pr_debug("%s: LED ON\n", DEVICE_NAME);
   } else if (kbuf[0] == '0') {
-    gpio_set_value(gpio_pin, 0);
-    led_state = 0;
-    printk(KERN_INFO "%s: LED OFF\n", DEVICE_NAME);
+    if (test_and_clear_bit(LED_FLAG_ON, &led->flags)) {
+      led_sync_output(led, LED_TRACE_WRITE);
+      led_pm_update(led);
+    }
+    pr_debug("%s: LED OFF\n", DEVICE_NAME);
   } else {
     printk(KERN_INFO "%s: Invalid command\n", DEVICE_NAME);
     return -EINVAL;
@@ -117,13 +510,16 @@ static ssize_t led_write(struct file *file, const char __user *buf,
 // Timer callback for LED blinking
 static void blink_timer_callback(struct timer_list *t) {
   struct gpio_led_data *led = from_timer(led, t, blink_timer);
+  bool was_on;
 
-  led->state = !led->state;
-  gpio_set_value(led->gpio_pin, led->state);
+  led->wakeups++;
+  was_on = test_and_change_bit(LED_FLAG_ON, &led->flags);
+  led_sync_output(led, LED_TRACE_BLINK);
 
-  if (led->blinking) {
-    unsigned long delay =
-        led->state ? led->blink_delay_on : led->blink_delay_off;
+  // LED_RESET clears the bit before del_timer_sync(), so no re-arm races it
+  if (test_bit(LED_FLAG_BLINKING, &led->flags)) {
+    unsigned long delay = was_on ? READ_ONCE(led->blink_delay_off)
+                                 : READ_ONCE(led->blink_delay_on);
     mod_timer(&led->blink_timer, jiffies + msecs_to_jiffies(delay));
   }
 }
@@ -132,6 +528,8 @@ static void blink_timer_callback(struct timer_list *t) {
 static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
   struct gpio_led_data *led = file->private_data;
   struct led_blink_params blink_params;
+  struct trigger_params trigger;
+  struct led_stats stats;
   int brightness;
 
   if (!led)
@@ -144,8 +542,12 @@ static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
     if (brightness < 0 || brightness > 100)
       return -EINVAL;
 
-    led->brightness = brightness;
-    gpio_set_value(led->gpio_pin, brightness > 0);
+    WRITE_ONCE(led->brightness, brightness);
+    assign_bit(LED_FLAG_ON, &led->flags, brightness > 0);
+    led_sync_output(led, LED_TRACE_IOCTL);
+    if (led->hardware_pwm)
+      led_pwm_apply(led);
+    led_pm_update(led);
     break;
 
   case LED_SET_BLINK:
@@ -153,19 +555,38 @@ static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
                        sizeof(blink_params)))
       return -EFAULT;
 
-    led->blinking = true;
-    led->blink_delay_on = blink_params.delay_on;
-    led->blink_delay_off = blink_params.delay_off;
+    // ctrl_lock keeps the flag and the timer together against LED_RESET
+    mutex_lock(&led->ctrl_lock);
+    WRITE_ONCE(led->blink_delay_on, blink_params.delay_on);
+    WRITE_ONCE(led->blink_delay_off, blink_params.delay_off);
+    set_bit(LED_FLAG_BLINKING, &led->flags);
+    led_pm_update(led);
     mod_timer(&led->blink_timer,
-              jiffies + msecs_to_jiffies(led->blink_delay_on));
+              jiffies + msecs_to_jiffies(blink_params.delay_on));
+    mutex_unlock(&led->ctrl_lock);
     break;
 
   case LED_RESET:
-    led->blinking = false;
-    del_timer(&led->blink_timer);
-    gpio_set_value(led->gpio_pin, 0);
-    led->state = 0;
-    led->brightness = 0;
+    mutex_lock(&led->ctrl_lock);
+    clear_bit(LED_FLAG_BLINKING, &led->flags);
+    del_timer_sync(&led->blink_timer);
+    WRITE_ONCE(led->brightness, 0);
+    clear_bit(LED_FLAG_ON, &led->flags);
+    led_sync_output(led, LED_TRACE_IOCTL);
+    led_pm_update(led);
+    mutex_unlock(&led->ctrl_lock);
+    break;
+
+  case LED_SET_TRIGGER:
+    if (copy_from_user(&trigger, (struct trigger_params __user *)arg,
+                       sizeof(trigger)))
+      return -EFAULT;
+    return led_set_trigger(led, &trigger);
+
+  case LED_GET_STATS:
+    led_get_stats(led, &stats);
+    if (copy_to_user((struct led_stats __user *)arg, &stats, sizeof(stats)))
+      return -EFAULT;
     break;
 
   default:
@@ -177,64 +598,206 @@ static long led_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
 
 // Thermal monitoring work function
 static void thermal_check_work(struct work_struct *work) {
-  struct gpio_led_data *led = container_of(work, struct gpio_led_data, work);
+  struct gpio_led_data *led =
+      container_of(to_delayed_work(work), struct gpio_led_data, work);
   int temp;
 
+  led->wakeups++;
   temp = get_cpu_temp(); // Implementation needed
   led->last_temp = temp;
 
-  if (temp >= led->thermal.temp_threshold && !led->thermal_shutdown) {
-    led->thermal_shutdown = true;
-    gpio_set_value(led->gpio_pin, 0);
-  } else if (temp <= (led->thermal.temp_threshold - led->thermal.hysteresis) &&
-             led->thermal_shutdown) {
-    led->thermal_shutdown = false;
-    gpio_set_value(led->gpio_pin, led->state);
+  if (temp >= led->thermal.temp_threshold) {
+    if (!test_and_set_bit(LED_FLAG_THERMAL, &led->flags))
+      led_sync_output(led, LED_TRACE_THERMAL);
+  } else if (temp <= (led->thermal.temp_threshold - led->thermal.hysteresis)) {
+    if (test_and_clear_bit(LED_FLAG_THERMAL, &led->flags)) {
+      led_sync_output(led, LED_TRACE_THERMAL);
+
+      // led_pm_update() skips the PWM while throttled; catch up now
+      mutex_lock(&led->pm_lock);
+      if (led->pm_active && led->pwm_released) {
+        pwm_enable(led->pwm);
+        led->pwm_released = false;
+      }
+      mutex_unlock(&led->pm_lock);
+    }
   }
 
-  if (led->thermal.auto_throttle) {
+  // Idle LEDs have nothing to throttle; polling resumes on activity
+  if (led->thermal.auto_throttle && READ_ONCE(led->pm_active)) {
     schedule_delayed_work(&led->work, HZ * 5); // Check every 5 seconds
   }
 }
 
-// Interrupt handler for external trigger
+// Threaded handler for the external trigger: runs in process context so
+// a trigger-lit LED takes its runtime PM reference and thermal polling
 static irqreturn_t led_trigger_handler(int irq, void *dev_id) {
   struct gpio_led_data *led = dev_id;
-  unsigned long flags;
 
-  spin_lock_irqsave(&led->lock, flags);
-  led->state = !led->state;
-  led->stats.switches++;
-  gpio_set_value(led->gpio_pin, led->state);
-  spin_unlock_irqrestore(&led->lock, flags);
+  change_bit(LED_FLAG_ON, &led->flags);
+  led_sync_output(led, LED_TRACE_TRIGGER);
+  led_pm_update(led);
 
   return IRQ_HANDLED;
 }
 
-// Power management suspend
+static void led_trigger_release(struct gpio_led_data *led) {
+  if (!led->trigger_irq)
+    return;
+
+  free_irq(led->trigger_irq, led);
+  gpio_free(led->trigger.gpio_trigger);
+  led->trigger_irq = 0;
+}
+
+// Toggle the LED on edges of an input GPIO; a negative gpio_trigger
+// removes the trigger
+static int led_set_trigger(struct gpio_led_data *led,
+                           const struct trigger_params *params) {
+  unsigned long irqflags = 0;
+  int irq, ret = 0;
+
+  if (params->gpio_trigger >= 0 && !params->rising_edge &&
+      !params->falling_edge)
+    return -EINVAL;
+
+  mutex_lock(&led->ctrl_lock);
+  led_trigger_release(led);
+  if (params->gpio_trigger < 0)
+    goto out;
+
+  ret = gpio_request_one(params->gpio_trigger, GPIOF_IN, "led-trigger");
+  if (ret)
+    goto out;
+
+  // Not every controller debounces in hardware; edges then pass as-is
+  if (params->debounce_ms)
+    gpio_set_debounce(params->gpio_trigger, params->debounce_ms * 1000);
+
+  irq = gpio_to_irq(params->gpio_trigger);
+  if (irq <= 0) {
+    ret = irq ? irq : -EINVAL;
+    goto err_gpio;
+  }
+
+  if (params->rising_edge)
+    irqflags |= IRQF_TRIGGER_RISING;
+  if (params->falling_edge)
+    irqflags |= IRQF_TRIGGER_FALLING;
+
+  ret = request_threaded_irq(irq, NULL, led_trigger_handler,
+                             irqflags | IRQF_ONESHOT, "led-trigger", led);
+  if (ret)
+    goto err_gpio;
+
+  led->trigger = *params;
+  led->trigger_irq = irq;
+  ret = 0;
+  goto out;
+
+err_gpio:
+  gpio_free(params->gpio_trigger);
+out:
+  mutex_unlock(&led->ctrl_lock);
+  return ret;
+}
+
+// Power management suspend: park every LED and remember where its
+// blink timeline was so resume can continue from the same position
 static int led_suspend(struct device *dev) {
-  struct gpio_led_data *led = dev_get_drvdata(dev);
+  struct gpio_led_data *led;
+  int i;
 
-  if (led->pwm)
-    pwm_disable(led->pwm);
+  for (i = 0; i < num_gpios; i++) {
+    led = led_data[i];
+    if (!led)
+      continue;
 
-  gpio_set_value(led->gpio_pin, 0);
-  led->stats.power_cycles++;
+    cancel_delayed_work_sync(&led->work);
+    del_timer_sync(&led->blink_timer);
+
+    led->blink_remaining = 0;
+    if (test_bit(LED_FLAG_BLINKING, &led->flags) &&
+        time_after(led->blink_timer.expires, jiffies))
+      led->blink_remaining = led->blink_timer.expires - jiffies;
+
+    if (led->hardware_pwm && !led->pwm_released)
+      pwm_disable(led->pwm);
+
+    set_bit(LED_FLAG_SUSPENDED, &led->flags);
+    led_sync_output(led, LED_TRACE_PM);
+    // Sleeping outputs park from a worker; finish before the bus suspends
+    flush_work(&led->output_work);
+    flush_work(&led->pwm_work);
+    led->stats.power_cycles++;
+  }
 
   return 0;
 }
 
-// Power management resume
+// Power management resume: restore level, PWM and blink phase
 static int led_resume(struct device *dev) {
-  struct gpio_led_data *led = dev_get_drvdata(dev);
+  struct gpio_led_data *led;
+  int i;
+
+  for (i = 0; i < num_gpios; i++) {
+    led = led_data[i];
+    if (!led)
+      continue;
+
+    clear_bit(LED_FLAG_SUSPENDED, &led->flags);
+    led_sync_output(led, LED_TRACE_PM);
+    flush_work(&led->output_work);
+    flush_work(&led->pwm_work);
+
+    if (led->hardware_pwm && !led->pwm_released &&
+        !test_bit(LED_FLAG_THERMAL, &led->flags))
+      pwm_enable(led->pwm);
+
+    if (test_bit(LED_FLAG_BLINKING, &led->flags)) {
+      unsigned long flags;
+
+      // Time the first blink edge after resume, for debugfs
+      spin_lock_irqsave(&led->lock, flags);
+      led->resume_ns = ktime_get_ns();
+      spin_unlock_irqrestore(&led->lock, flags);
+
+      mod_timer(&led->blink_timer, jiffies + led->blink_remaining);
+    }
 
-  if (led->pwm && !led->thermal_shutdown)
-    pwm_enable(led->pwm);
+    if (led->pm_active && led->thermal.auto_throttle)
+      schedule_delayed_work(&led->work, HZ);
+  }
 
   return 0;
 }
 
-static SIMPLE_DEV_PM_OPS(led_pm_ops, led_suspend, led_resume);
+// Runtime suspend: every LED is idle and has normally released its PWM
+// already; catch any still held
+static int led_runtime_suspend(struct device *dev) {
+  struct gpio_led_data *led;
+  int i;
+
+  for (i = 0; i < num_gpios; i++) {
+    led = led_data[i];
+    if (!led)
+      continue;
+
+    if (led->hardware_pwm && !led->pwm_released) {
+      pwm_disable(led->pwm);
+      led->pwm_released = true;
+    }
+  }
+
+  return 0;
+}
+
+// Runtime resume: PWM is re-acquired per LED in led_pm_update()
+static int led_runtime_resume(struct device *dev) { return 0; }
+
+static const struct dev_pm_ops led_pm_ops = {
+    SET_SYSTEM_SLEEP_PM_OPS(led_suspend, led_resume)
+        SET_RUNTIME_PM_OPS(led_runtime_suspend, led_runtime_resume, NULL)};
 
 // Add helper function for temperature reading
 static int get_cpu_temp(void) {
@@ -254,6 +817,7 @@ static int gpio_led_probe(struct platform_device *pdev) {
   struct device_node *np = pdev->dev.of_node;
   int i, ret;
   struct gpio_led_data *led;
+  struct device *node;
 
   if (!np)
     return -ENODEV;
@@ -262,53 +826,110 @@ static int gpio_led_probe(struct platform_device *pdev) {
   if (num_gpios > MAX_GPIOS)
     num_gpios = MAX_GPIOS;
 
+  // All LEDs start idle; the controller autosuspends until one is used
+  pm_runtime_set_autosuspend_delay(&pdev->dev, autosuspend_delay_ms);
+  pm_runtime_use_autosuspend(&pdev->dev);
+  pm_runtime_get_noresume(&pdev->dev);
+  pm_runtime_set_active(&pdev->dev);
+  pm_runtime_enable(&pdev->dev);
+
+  ret = led_trace_init();
+  if (ret)
+    dev_warn(&pdev->dev, "Edge tracing unavailable: %d\n", ret);
+
   for (i = 0; i < num_gpios; i++) {
     led = devm_kzalloc(&pdev->dev, sizeof(*led), GFP_KERNEL);
-    if (!led)
-      return -ENOMEM;
+    if (!led) {
+      ret = -ENOMEM;
+      goto err_unwind;
+    }
 
     led_data[i] = led;
+    led->dev = &pdev->dev;
+    led->index = i;
 
     // Initialize basic LED data
     led->gpio_pin = of_get_gpio(np, i);
     if (!gpio_is_valid(led->gpio_pin)) {
       dev_err(&pdev->dev, "Invalid GPIO %d\n", i);
-      return -EINVAL;
+      ret = -EINVAL;
+      goto err_unwind;
     }
 
     // Set default values
     led->thermal.temp_threshold = 80; // 80°C default
     led->thermal.hysteresis = 5;
     led->thermal.auto_throttle = true;
+    led->power_mw = 60; // ~20 mA at 3.3 V
+    led->probe_ns = ktime_get_ns();
+    led->last_change_ns = led->probe_ns;
 
     ret = devm_gpio_request_one(&pdev->dev, led->gpio_pin, GPIOF_OUT_INIT_LOW,
                                 "led-gpio");
     if (ret) {
       dev_err(&pdev->dev, "Failed to request GPIO %d\n", led->gpio_pin);
-      return ret;
+      goto err_unwind;
     }
 
     // Initialize timer and work
     timer_setup(&led->blink_timer, blink_timer_callback, 0);
     INIT_DELAYED_WORK(&led->work, thermal_check_work);
+    INIT_WORK(&led->output_work, led_output_work);
+    INIT_WORK(&led->pwm_work, led_pwm_work);
     spin_lock_init(&led->lock);
+    mutex_init(&led->pm_lock);
+    mutex_init(&led->ctrl_lock);
 
     // Setup PWM if available
     led->pwm = devm_pwm_get(&pdev->dev, kasprintf(GFP_KERNEL, "led%d", i));
-    if (!IS_ERR(led->pwm)) {
+    // PWM and thermal polling stay off until the LED becomes active
+    if (IS_ERR(led->pwm)) {
+      led->pwm = NULL;
+    } else {
       led->hardware_pwm = true;
-      pwm_enable(led->pwm);
+      led->pwm_released = true;
+      led->pwm_period_ns = pwm_get_period(led->pwm) ?: NSEC_PER_MSEC;
+      led->pwm_duty = UINT_MAX; // Not programmed yet
     }
 
-    // Start thermal monitoring if enabled
-    if (led->thermal.auto_throttle)
-      schedule_delayed_work(&led->work, HZ);
+    led->ops = led_classify(led);
+
+    // LED 0 keeps the historical /dev/led_controller node
+    if (i)
+      node = device_create(device_class, &pdev->dev,
+                           MKDEV(MAJOR(dev_num), i), NULL, DEVICE_NAME "%d",
+                           i);
+    else
+      node = device_create(device_class, &pdev->dev, MKDEV(MAJOR(dev_num), 0),
+                           NULL, DEVICE_NAME);
+    if (IS_ERR(node)) {
+      ret = PTR_ERR(node);
+      goto err_unwind;
+    }
 
     // Initialize debugfs entries
     led_debugfs_init(led);
   }
 
+  pm_runtime_mark_last_busy(&pdev->dev);
+  pm_runtime_put_autosuspend(&pdev->dev);
+
   return 0;
+
+err_unwind:
+  // LEDs set up so far are idle: no timers, work or PM references yet
+  while (--i >= 0) {
+    device_destroy(device_class, MKDEV(MAJOR(dev_num), i));
+    led_debugfs_remove(led_data[i]);
+  }
+  memset(led_data, 0, sizeof(led_data));
+  led_debugfs_cleanup();
+  led_trace_remove();
+  pm_runtime_dont_use_autosuspend(&pdev->dev);
+  pm_runtime_put_noidle(&pdev->dev);
+  pm_runtime_disable(&pdev->dev);
+  pm_runtime_set_suspended(&pdev->dev);
+  return ret;
 }
 
 // Fix cleanup in remove function
@@ -319,15 +940,28 @@ static int gpio_led_remove(struct platform_device *pdev) {
   for (i = 0; i < num_gpios; i++) {
     led = led_data[i];
     if (led) {
+      led_trigger_release(led);
       cancel_delayed_work_sync(&led->work);
       del_timer_sync(&led->blink_timer);
-      if (led->pwm)
+      cancel_work_sync(&led->output_work);
+      cancel_work_sync(&led->pwm_work);
+      if (led->hardware_pwm && !led->pwm_released)
         pwm_disable(led->pwm);
-      gpio_set_value(led->gpio_pin, 0);
+      gpio_set_value_cansleep(led->gpio_pin, 0);
+      if (led->pm_active)
+        pm_runtime_put_noidle(&pdev->dev);
+      device_destroy(device_class, MKDEV(MAJOR(dev_num), i));
       led_debugfs_remove(led);
     }
   }
 
+  cancel_work_sync(&budget_work);
+  led_debugfs_cleanup();
+  led_trace_remove();
+  pm_runtime_disable(&pdev->dev);
+  pm_runtime_dont_use_autosuspend(&pdev->dev);
+  pm_runtime_set_suspended(&pdev->dev);
+
   return 0;
 }
 
@@ -350,82 +984,56 @@ static struct platform_driver gpio_led_driver = {
         },
 };
 
-// Fix module initialization
+// Module init: one char device minor per LED; probe creates the nodes
 static int __init my_module_init(void) {
   int ret;
 
-  ret = platform_driver_register(&gpio_led_driver);
-  if (ret)
-    return ret;
-
-  // --- GPIO Request and Direction ---
-  if (!gpio_is_valid(gpio_pin)) {
-    printk(KERN_ERR "%s: Invalid GPIO pin: %d\n", DEVICE_NAME, gpio_pin);
-    return -ENODEV;
-  }
-
-  ret = gpio_request(gpio_pin, "led-gpio");
+  ret = alloc_chrdev_region(&dev_num, 0, MAX_GPIOS, DEVICE_NAME);
   if (ret) {
-    printk(KERN_ERR "%s: Failed to request GPIO pin %d\n", DEVICE_NAME,
-           gpio_pin);
+    printk(KERN_ERR "%s: Failed to allocate a major number\n", DEVICE_NAME);
     return ret;
   }
 
-  ret = gpio_direction_output(gpio_pin, 0); // Set as output, initial state off
-  if (ret) {
-    printk(KERN_ERR "%s: Failed to set GPIO direction\n", DEVICE_NAME);
-    gpio_free(gpio_pin);
-    return ret;
-  }
-
-  // --- Character Device Registration ---
-  major_number = register_chrdev(0, DEVICE_NAME, &fops);
-  if (major_number < 0) {
-    printk(KERN_ERR "%s: Failed to register a major number\n", DEVICE_NAME);
-    gpio_free(gpio_pin);
-    return major_number;
-  }
-  printk(KERN_INFO "%s: Registered correctly with major number %d\n",
-         DEVICE_NAME, major_number);
+  cdev_init(&gpio_cdev, &fops);
+  gpio_cdev.owner = THIS_MODULE;
+  ret = cdev_add(&gpio_cdev, dev_num, MAX_GPIOS);
+  if (ret)
+    goto err_region;
 
-  // --- Class Creation ---
   device_class = class_create(THIS_MODULE, DEVICE_NAME);
   if (IS_ERR(device_class)) {
     printk(KERN_ERR "%s: Failed to register device class\n", DEVICE_NAME);
-    unregister_chrdev(major_number, DEVICE_NAME);
-    gpio_free(gpio_pin);
-    return PTR_ERR(device_class);
+    ret = PTR_ERR(device_class);
+    goto err_cdev;
   }
 
-  // --- Device Creation ---
-  device = device_create(device_class, NULL, MKDEV(major_number, 0), NULL,
-                         DEVICE_NAME);
-  if (IS_ERR(device)) {
-    printk(KERN_ERR "%s: Failed to create device\n", DEVICE_NAME);
-    class_destroy(device_class);
-    unregister_chrdev(major_number, DEVICE_NAME);
-    gpio_free(gpio_pin);
-    return PTR_ERR(device);
-  }
+  ret = platform_driver_register(&gpio_led_driver);
+  if (ret)
+    goto err_class;
 
-  printk(KERN_INFO "%s: Device class created correctly\n", DEVICE_NAME);
-  return 0; // OK
+  printk(KERN_INFO "%s: Registered with major number %d\n", DEVICE_NAME,
+         MAJOR(dev_num));
+  return 0;
+
+err_class:
+  class_destroy(device_class);
+err_cdev:
+  cdev_del(&gpio_cdev);
+err_region:
+  unregister_chrdev_region(dev_num, MAX_GPIOS);
+  return ret;
 }
 
 static void __exit my_module_exit(void) {
-  // Unregister platform driver
   platform_driver_unregister(&gpio_led_driver);
+  cancel_work_sync(&budget_work);
 
-  // Destroy device and class
-  device_destroy(device_class, MKDEV(major_number, 0));
   class_destroy(device_class);
-
-  // Unregister character device
-  unregister_chrdev(major_number, DEVICE_NAME);
-
-  // Free GPIO
-  gpio_set_value(gpio_pin, 0); // Turn off LED
-  gpio_free(gpio_pin);
+  cdev_del(&gpio_cdev);
+  unregister_chrdev_region(dev_num, MAX_GPIOS);
 
   printk(KERN_INFO "%s: Exiting the LED controller module\n", DEVICE_NAME);
-}
\ No newline at end of file
+}
+
+module_init(my_module_init);
+module_exit(my_module_exit);
@@ -1,74 +1,83 @@
 #ifndef GPIO_LED_H
 #define GPIO_LED_H
 
-#include <linux/ioctl.h>
+#include "gpio_ioctl.h"
 
 #define MAX_GPIOS 8
 #define DEVICE_NAME "led_controller"
 
-// IOCTL commands
-#define LED_IOC_MAGIC 'L'
-#define LED_SET_BRIGHTNESS _IOW(LED_IOC_MAGIC, 1, int)
-#define LED_SET_BLINK _IOW(LED_IOC_MAGIC, 2, struct led_blink_params)
-#define LED_RESET _IO(LED_IOC_MAGIC, 3)
+// Bits of gpio_led_data.flags, the per-LED state word. Writers update it
+// with atomic bitops and then bring the output in line under led->lock.
+enum led_flag_bits {
+  LED_FLAG_ON,        // Output requested lit
+  LED_FLAG_BLINKING,  // Blink timer owns LED_FLAG_ON
+  LED_FLAG_THERMAL,   // Forced dark by thermal shutdown
+  LED_FLAG_SUSPENDED, // Forced dark by system suspend
+};
+
+// Flags that keep the output dark even when LED_FLAG_ON is set
+#define LED_LEVEL_MASK                                                         \
+  (BIT(LED_FLAG_ON) | BIT(LED_FLAG_THERMAL) | BIT(LED_FLAG_SUSPENDED))
 
-// Additional IOCTL commands
-#define LED_SET_PWM _IOW(LED_IOC_MAGIC, 4, struct pwm_params)
-#define LED_GET_STATS _IOR(LED_IOC_MAGIC, 5, struct led_stats)
-#define LED_SET_TRIGGER _IOW(LED_IOC_MAGIC, 6, struct trigger_params)
-#define LED_SET_THERMAL _IOW(LED_IOC_MAGIC, 7, struct thermal_params)
+struct gpio_led_data;
+
+// Output path selected at probe from the LED's capabilities
+struct led_output_ops {
+  const char *name;
+  void (*set)(struct gpio_led_data *led, int level);
+  const unsigned int *duty_scale; // Percent applied to accounted duty
+  bool dims;                      // Brightness reaches the output
+};
 
 struct gpio_led_data {
+  int index;
   int gpio_pin;
-  int state;
+  unsigned long flags;
+  int out_level; // Level last driven, protected by lock
+  const struct led_output_ops *ops;
+  int pending_level; // Level for output_work on sleeping GPIOs
+  struct work_struct output_work;
+  unsigned int pwm_duty; // Duty (%) last programmed, under pm_lock
+  struct work_struct pwm_work;
   unsigned int brightness;
   struct timer_list blink_timer;
-  bool blinking;
   unsigned int blink_delay_on;
   unsigned int blink_delay_off;
   struct pwm_device *pwm;
   struct led_stats stats;
   struct trigger_params trigger;
+  int trigger_irq; // 0 while no trigger is installed
   struct thermal_params thermal;
-  struct work_struct work;
+  struct delayed_work work;
   struct dentry *debugfs_dir;
   spinlock_t lock;
+  struct mutex pm_lock;
+  struct mutex ctrl_lock; // Serializes blink/reset/trigger control
   bool hardware_pwm;
-  bool thermal_shutdown;
   int last_temp;
+  struct device *dev;
+  bool pm_active;                // LED holds a runtime PM reference
+  bool pwm_released;             // PWM disabled while the LED is idle
+  unsigned long blink_remaining; // Jiffies left in blink phase at suspend
+  u64 resume_ns;                 // Resume time until the first edge
+  u64 resume_edge_ns;            // Resume to first blink edge, last resume
+  unsigned long wakeups;         // Timer and thermal callbacks run
+  unsigned int pwm_period_ns;
+  unsigned int power_mw;    // Estimated draw at full brightness
+  unsigned int draw_mw;     // Estimated draw at the current duty
+  unsigned int cur_duty;    // Effective duty (%) since last_change_ns
+  u64 probe_ns;
+  u64 last_change_ns;
+  u64 on_time_ns;   // Time spent lit
+  u64 duty_time_ns; // Lit time weighted by brightness/PWM duty
+  unsigned int bench_toggles; // Last toggle_bench run
+  u64 bench_legacy_ns;
+  u64 bench_ops_ns;
 };
 
-struct led_blink_params {
-  unsigned int delay_on;
-  unsigned int delay_off;
-};
-
-struct pwm_params {
-  unsigned int period_ns;
-  unsigned int duty_cycle;
-  bool hardware_pwm;
-};
-
-struct led_stats {
-  unsigned long switches;
-  unsigned long pwm_changes;
-  unsigned long errors;
-  unsigned long uptime;
-  unsigned long power_cycles;
-};
-
-struct trigger_params {
-  int gpio_trigger;
-  bool rising_edge;
-  bool falling_edge;
-  unsigned int debounce_ms;
-};
-
-struct thermal_params {
-  int temp_threshold;
-  int hysteresis;
-  bool auto_throttle;
-};
+void led_get_stats(struct gpio_led_data *led, struct led_stats *stats);
+int led_toggle_bench(struct gpio_led_data *led, unsigned int n,
+                     u64 *legacy_ns, u64 *ops_ns);
 
 // Power management states
 enum led_power_state { LED_POWER_ON, LED_POWER_SUSPEND, LED_POWER_OFF };
@@ -1,17 +1,38 @@
+#include "gpio.h"
 #include "gpio_debugfs.h"
 #include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/seq_file.h>
 
 static int stats_show(struct seq_file *s, void *private) {
   struct gpio_led_data *led = s->private;
+  struct led_stats stats;
 
-  seq_printf(s, "Switches: %lu\n", led->stats.switches);
-  seq_printf(s, "PWM changes: %lu\n", led->stats.pwm_changes);
-  seq_printf(s, "Errors: %lu\n", led->stats.errors);
-  seq_printf(s, "Uptime: %lu seconds\n", led->stats.uptime);
-  seq_printf(s, "Power cycles: %lu\n", led->stats.power_cycles);
+  led_get_stats(led, &stats);
+
+  seq_printf(s, "Output: %s\n", led->ops->name);
+  seq_printf(s, "Switches: %llu\n", stats.switches);
+  seq_printf(s, "PWM changes: %llu\n", stats.pwm_changes);
+  seq_printf(s, "Errors: %llu\n", stats.errors);
+  seq_printf(s, "Uptime: %llu seconds\n", stats.uptime);
+  seq_printf(s, "On time: %llu ms\n", div_u64(stats.on_time_ns, NSEC_PER_MSEC));
+  seq_printf(s, "Duty time: %llu ms\n",
+             div_u64(stats.duty_time_ns, NSEC_PER_MSEC));
+  seq_printf(s, "Energy: %llu uJ\n", stats.energy_uj);
+  seq_printf(s, "Estimated draw: %u mW\n", led->draw_mw);
+  seq_printf(s, "Power cycles: %llu\n", stats.power_cycles);
   seq_printf(s, "Temperature: %d°C\n", led->last_temp);
-  seq_printf(s, "Thermal shutdown: %s\n", led->thermal_shutdown ? "yes" : "no");
+  seq_printf(s, "Thermal shutdown: %s\n",
+             test_bit(LED_FLAG_THERMAL, &led->flags) ? "yes" : "no");
+  seq_printf(s, "Runtime PM: %s\n", led->pm_active ? "active" : "idle");
+  seq_printf(s, "Wakeups: %lu\n", led->wakeups);
+  seq_printf(s, "Resume phase remaining: %u ms\n",
+             jiffies_to_msecs(led->blink_remaining));
+  seq_printf(s, "Resume to first edge: %llu us\n",
+             div_u64(led->resume_edge_ns, NSEC_PER_USEC));
 
   return 0;
 }
@@ -28,15 +49,78 @@ static const struct file_operations stats_fops = {
     .release = single_release,
 };
 
+// Write a toggle count to run the legacy and current output steps, read
+// back ns/toggle
+static ssize_t bench_write(struct file *file, const char __user *buf,
+                           size_t count, loff_t *ppos) {
+  struct gpio_led_data *led = file->private_data;
+  unsigned int n;
+  int ret;
+
+  ret = kstrtouint_from_user(buf, count, 0, &n);
+  if (ret)
+    return ret;
+  if (!n || n > 100000)
+    return -EINVAL;
+
+  ret = led_toggle_bench(led, n, &led->bench_legacy_ns, &led->bench_ops_ns);
+  if (ret)
+    return ret;
+  led->bench_toggles = n;
+
+  return count;
+}
+
+static ssize_t bench_read(struct file *file, char __user *buf, size_t count,
+                          loff_t *ppos) {
+  struct gpio_led_data *led = file->private_data;
+  unsigned int n = led->bench_toggles ? led->bench_toggles : 1;
+  char out[96];
+  int len;
+
+  len = scnprintf(out, sizeof(out),
+                  "toggles: %u\nlegacy: %llu ns/toggle\n%s: %llu ns/toggle\n",
+                  led->bench_toggles, div_u64(led->bench_legacy_ns, n),
+                  led->ops->name, div_u64(led->bench_ops_ns, n));
+
+  return simple_read_from_buffer(buf, count, ppos, out, len);
+}
+
+static const struct file_operations bench_fops = {
+    .owner = THIS_MODULE,
+    .open = simple_open,
+    .read = bench_read,
+    .write = bench_write,
+    .llseek = default_llseek,
+};
+
+// led_controller/led<N>/ per LED under one shared parent
+static struct dentry *led_debugfs_root;
+
 void led_debugfs_init(struct gpio_led_data *led) {
-  led->debugfs_dir = debugfs_create_dir("led_controller", NULL);
+  char name[16];
+
+  if (!led_debugfs_root)
+    led_debugfs_root = debugfs_create_dir("led_controller", NULL);
+
+  snprintf(name, sizeof(name), "led%d", led->index);
+  led->debugfs_dir = debugfs_create_dir(name, led_debugfs_root);
   debugfs_create_file("stats", 0444, led->debugfs_dir, led, &stats_fops);
   debugfs_create_bool("hardware_pwm", 0444, led->debugfs_dir,
                       &led->hardware_pwm);
   debugfs_create_u32("temp_threshold", 0644, led->debugfs_dir,
                      &led->thermal.temp_threshold);
+  debugfs_create_u32("power_mw", 0644, led->debugfs_dir, &led->power_mw);
+  debugfs_create_file("toggle_bench", 0600, led->debugfs_dir, led,
+                      &bench_fops);
 }
 
 void led_debugfs_remove(struct gpio_led_data *led) {
   debugfs_remove_recursive(led->debugfs_dir);
+  led->debugfs_dir = NULL;
+}
+
+void led_debugfs_cleanup(void) {
+  debugfs_remove_recursive(led_debugfs_root);
+  led_debugfs_root = NULL;
 }
@@ -0,0 +1,80 @@
+#include "gpio_trace.h"
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/relay.h>
+
+// 8 x 64 KiB per CPU holds 32768 edges between reader passes
+#define TRACE_SUBBUF_SIZE (64 * 1024)
+#define TRACE_N_SUBBUFS 8
+
+static struct rchan *trace_chan;
+static struct dentry *trace_dir;
+static bool trace_enabled;
+static atomic_t trace_dropped = ATOMIC_INIT(0);
+
+static struct dentry *trace_create_buf_file(const char *filename,
+                                            struct dentry *parent,
+                                            umode_t mode, struct rchan_buf *buf,
+                                            int *is_global) {
+  return debugfs_create_file(filename, mode, parent, buf,
+                             &relay_file_operations);
+}
+
+static int trace_remove_buf_file(struct dentry *dentry) {
+  debugfs_remove(dentry);
+  return 0;
+}
+
+// No-overwrite mode: keep the oldest data and count what a full ring drops
+static int trace_subbuf_start(struct rchan_buf *buf, void *subbuf,
+                              void *prev_subbuf, size_t prev_padding) {
+  if (relay_buf_full(buf)) {
+    atomic_inc(&trace_dropped);
+    return 0;
+  }
+
+  return 1;
+}
+
+static const struct rchan_callbacks trace_callbacks = {
+    .subbuf_start = trace_subbuf_start,
+    .create_buf_file = trace_create_buf_file,
+    .remove_buf_file = trace_remove_buf_file,
+};
+
+// Record an output change. relay_write() only touches the local CPU's
+// buffer with interrupts off, so no lock is shared between CPUs.
+void led_trace_record(int led, int level, enum led_trace_source source) {
+  struct led_trace_event ev = {};
+
+  if (!READ_ONCE(trace_enabled))
+    return;
+
+  ev.ts_ns = ktime_get_ns();
+  ev.led = led;
+  ev.level = level;
+  ev.source = source;
+  relay_write(trace_chan, &ev, sizeof(ev));
+}
+
+int led_trace_init(void) {
+  trace_dir = debugfs_create_dir("led_controller_trace", NULL);
+
+  trace_chan = relay_open("trace", trace_dir, TRACE_SUBBUF_SIZE,
+                          TRACE_N_SUBBUFS, &trace_callbacks, NULL);
+  if (!trace_chan) {
+    debugfs_remove_recursive(trace_dir);
+    return -ENOMEM;
+  }
+
+  debugfs_create_bool("enable", 0644, trace_dir, &trace_enabled);
+  debugfs_create_atomic_t("dropped", 0444, trace_dir, &trace_dropped);
+
+  return 0;
+}
+
+void led_trace_remove(void) {
+  WRITE_ONCE(trace_enabled, false);
+  relay_close(trace_chan);
+  debugfs_remove_recursive(trace_dir);
+}